@@ -1,17 +1,41 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <functional>
+#include <memory_resource>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <utility>
+#include <vector>
+#include "../common/book_event.h"
 #include "../common/order_book.h"
+#include "../common/spsc_ring.h"
+
+// Compact venue index, assigned when an adapter is registered with a
+// pipeline's venue table; also the adapter's slot in per-venue arrays.
+using VenueId = std::uint16_t;
 
 class AdapterBase {
 public:
-  using Callback = std::function<void(const OrderBook&, const char* venue)>;
+  using Callback = std::function<void(const OrderBook&, VenueId venue)>;
+  using DeltaRing = SpscRing<BookEvent>;
+
+  // Conflation: apply every frame already buffered on the connection (and, with
+  // a non-zero window, every frame arriving within window of the first one)
+  // before publishing once. Set before start().
+  struct Conflation {
+    bool enabled{false};
+    std::chrono::microseconds window{0};
+    std::size_t max_frames{256};
+  };
 
-  explicit AdapterBase(std::string symbol) : symbol_(std::move(symbol)) {}
+  AdapterBase(std::string symbol, FixedScale scale, double price_tick)
+    : symbol_(std::move(symbol)), scale_(scale), tick_(scale.tick_to_px(price_tick)) {}
   virtual ~AdapterBase() { stop(); }
 
   void start(Callback cb) {
@@ -20,19 +44,136 @@ public:
     th_ = std::thread([this, cb]{ this->run(cb); });
   }
 
+  // Delta mode: instead of handing over the whole book, push the levels each
+  // message changed into ring (owned by the consumer, one ring per adapter)
+  // and let the consumer keep its own BookReplica. The adapter thread never
+  // waits on the consumer: if the ring is full the message is dropped and the
+  // next one carries a full snapshot. The ring must hold a full snapshot.
+  void start(DeltaRing* ring) {
+    ring_ = ring;
+    journal_.reserve(4096);
+    start(Callback{});
+  }
+
   void stop() {
     bool expected = true;
     if (!running_.compare_exchange_strong(expected, false)) return;
+    interrupt();
     if (th_.joinable()) th_.join();
   }
 
+  px_t price_tick() const { return tick_; }
+  // Levels per side the venue's book is cut to at price_tick(), or 0 if it
+  // is the full book.
+  virtual std::size_t depth_limit() const { return 0; }
+
+  // Exchange name, for logs.
+  virtual const char* name() const = 0;
+  VenueId venue_id() const { return venue_id_; }
+  void set_venue_id(VenueId id) { venue_id_ = id; }
+
+  void set_conflation(Conflation c) { conflation_ = c; }
+  // Frames applied without a publish of their own because they were conflated.
+  std::uint64_t coalesced_frames() const { return coalesced_.load(std::memory_order_relaxed); }
+
+  // Delta mode: messages dropped because the ring was full.
+  std::uint64_t dropped_messages() const { return dropped_.load(std::memory_order_relaxed); }
+  // Books found inconsistent with the venue (failed checksum or sequence
+  // check) and resubscribed on the open connection.
+  std::uint64_t resubscribes() const { return resubscribes_.load(std::memory_order_relaxed); }
+
 protected:
   virtual void run(Callback cb) = 0;
+  // Called by stop() after running() turns false, to wake a run() blocked on
+  // I/O. Adapters overriding it must call stop() in their own destructor.
+  virtual void interrupt() {}
   bool running() const { return running_.load(std::memory_order_relaxed); }
   std::string symbol_;
+  FixedScale scale_;
+  px_t tick_;  // venue price increment, in price units
+  VenueId venue_id_{0};
+
+  // Per-adapter allocation, touched only by the adapter thread: book nodes come
+  // from an unsynchronized pool (no global-heap contention between adapters,
+  // freed nodes are reused), and per-message delta scratch from a monotonic
+  // arena that is rewound before each message.
+  std::pmr::memory_resource* scratch() { scratch_.release(); return &scratch_; }
+  std::pmr::unsynchronized_pool_resource book_pool_;
+
+  Conflation conflation_;
+  void count_burst(std::size_t frames) {
+    if (frames > 1) coalesced_.fetch_add(frames - 1, std::memory_order_relaxed);
+  }
+
+  // Book writes go through these so that delta mode can journal them.
+  void reset_book(OrderBook& book) {
+    book.bids.clear();
+    book.asks.clear();
+    if (ring_) journal_.push_back({BookEvent::Kind::kReset});
+  }
+  void set_level(OrderBook& book, BookEvent::Kind side, px_t p, qty_t q) {
+    if (side == BookEvent::Kind::kBid) book.bids.set(p, q);
+    else book.asks.set(p, q);
+    if (ring_) journal_.push_back({side, p, q});
+  }
+  void apply_levels(OrderBook& book, BookEvent::Kind side, std::span<const Delta> deltas) {
+    for (const auto& [p, q] : deltas) set_level(book, side, p, q);
+  }
+
+  // The book no longer matches the venue's: clear it (consumers drop this
+  // venue rather than merge a wrong book) and have run() resubscribe the
+  // channel on the same connection once the current burst is applied; the
+  // fresh snapshot rebuilds it. take_resubscribe() is run()'s side.
+  void invalidate_book(OrderBook& book) {
+    reset_book(book);
+    resubscribe_ = true;
+    resubscribes_.fetch_add(1, std::memory_order_relaxed);
+  }
+  bool take_resubscribe() { return std::exchange(resubscribe_, false); }
+
+  // Deliver the book if this update changed anything. In delta mode the
+  // changes are pushed instead.
+  void publish(const Callback& cb, OrderBook& book) {
+    const BookChange ch = book.take_changes();
+    if (ring_) { push_deltas(book); return; }
+    if (!ch.any()) return;
+    cb(book, venue_id_);
+  }
   std::mutex book_mu_;
 
 private:
+  // Push the levels journalled since the last push as one message, or a full
+  // snapshot if the previous message did not fit.
+  void push_deltas(const OrderBook& book) {
+    if (resync_) {
+      journal_.clear();
+      journal_.push_back({BookEvent::Kind::kReset});
+      for (const auto& [p, s] : book.bids) journal_.push_back({BookEvent::Kind::kBid, p, s});
+      for (const auto& [p, s] : book.asks) journal_.push_back({BookEvent::Kind::kAsk, p, s});
+    }
+    if (journal_.empty()) return;
+    journal_.push_back({BookEvent::Kind::kCommit, 0, 0, seq_ + 1});
+    if (ring_->try_push(journal_)) {
+      ++seq_;
+      resync_ = false;
+    } else {
+      resync_ = true;
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+    }
+    journal_.clear();
+  }
+
+  std::array<std::byte, 64 * 1024> scratch_buf_;
+  std::pmr::monotonic_buffer_resource scratch_{scratch_buf_.data(), scratch_buf_.size(), &book_pool_};
   std::thread th_;
   std::atomic<bool> running_{false};
+  std::atomic<std::uint64_t> coalesced_{0};
+  bool resubscribe_{false};   // adapter thread only
+  std::atomic<std::uint64_t> resubscribes_{0};
+
+  DeltaRing* ring_{nullptr};
+  std::vector<BookEvent> journal_;   // adapter thread only
+  std::uint64_t seq_{0};
+  bool resync_{false};
+  std::atomic<std::uint64_t> dropped_{0};
 };
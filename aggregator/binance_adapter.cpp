@@ -1,4 +1,6 @@
 #include "binance_adapter.h"
+#include "json_cursor.h"
+#include "ws_conflation.h"
 #include <boost/asio.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/ssl.hpp>
@@ -6,6 +8,7 @@
 #include <boost/beast/http.hpp>
 #include <boost/asio/ssl/context.hpp>
 #include <nlohmann/json.hpp>
+#include <algorithm>
 #include <iostream>
 #include <chrono>
 #include <sstream>
@@ -18,12 +21,17 @@ using json = nlohmann::json;
 
 static std::string to_lower(std::string s){ for (auto& c: s) c=std::tolower(c); return s; }
 
-BinanceAdapter::BinanceAdapter(std::string symbol) : AdapterBase(std::move(symbol)){}
+BinanceAdapter::BinanceAdapter(std::string symbol, FixedScale scale, double price_tick)
+  : AdapterBase(std::move(symbol), scale, price_tick){}
 BinanceAdapter::~BinanceAdapter(){ stop(); }
 
 
-bool BinanceAdapter::fetch_snapshot(
-    OrderBook& out_book, long long& last_update_id, std::string& err) {
+// Runs on the snapshot thread: fills out only, never touches the adapter's
+// book or allocators. Connect, TLS handshake, request and response share one
+// kSnapshotTimeout budget (tcp_stream timeouts only cover asynchronous
+// operations, so each step is run async to completion), so a stalled
+// request cannot hold up a refetch or stop().
+bool BinanceAdapter::fetch_snapshot(Snapshot& out, std::string& err) {
   try {
     boost::asio::io_context ioc;
     ssl::context ctx{ssl::context::tls_client};
@@ -31,28 +39,41 @@ bool BinanceAdapter::fetch_snapshot(
 
     tcp::resolver resolver{ioc};
     boost::beast::ssl_stream<boost::beast::tcp_stream> stream{ioc, ctx};
+    auto& tcp_layer = boost::beast::get_lowest_layer(stream);
 
     auto const host = "api.binance.com";
     auto const port = "443";
     auto const target = std::string("/api/v3/depth?symbol=") + symbol_ + "&limit=1000";
 
+    boost::system::error_code ec;
+    auto run = [&](auto start) {
+      start([&](boost::system::error_code e, auto&&...) { ec = e; });
+      ioc.restart();
+      ioc.run();
+      if (ec) throw boost::system::system_error(ec);
+    };
+
     auto const results = resolver.resolve(host, port);
-    boost::beast::get_lowest_layer(stream).connect(results);
+    tcp_layer.expires_after(kSnapshotTimeout);
+    run([&](auto done) { tcp_layer.async_connect(results, done); });
     if (! SSL_set_tlsext_host_name(stream.native_handle(), host)) {
       throw std::runtime_error("SNI set failed");
     }
-    stream.handshake(ssl::stream_base::client);
+    run([&](auto done) { stream.async_handshake(ssl::stream_base::client, done); });
 
     http::request<http::string_body> req{http::verb::get, target, 11};
     req.set(http::field::host, host);
     req.set(http::field::user_agent, "beast");
-    http::write(stream, req);
+    run([&](auto done) { http::async_write(stream, req, done); });
 
     boost::beast::flat_buffer buffer;
     http::response<http::string_body> res;
-    http::read(stream, buffer, res);
-    boost::system::error_code ec;
-    stream.shutdown(ec);
+    run([&](auto done) { http::async_read(stream, buffer, res, done); });
+    try {
+      run([&](auto done) { stream.async_shutdown(done); });
+    } catch (const boost::system::system_error&) {
+      // servers commonly skip the TLS close_notify; the response is complete
+    }
 
     if (res.result() != http::status::ok) {
       err = "HTTP " + std::to_string((int)res.result());
@@ -60,19 +81,20 @@ bool BinanceAdapter::fetch_snapshot(
     }
 
     auto j = json::parse(res.body());
-    last_update_id = j.at("lastUpdateId").get<long long>();
-    out_book.bids.clear(); out_book.asks.clear();
+    out.last_update_id = j.at("lastUpdateId").get<long long>();
+    out.bids.clear();
+    out.asks.clear();
 
     for (auto& lvl : j["bids"]) {
-      double p = std::stod(lvl[0].get<std::string>());
-      double s = std::stod(lvl[1].get<std::string>());
-      if (s>0) out_book.bids[p] = s;
+      px_t p = scale_.parse_px(lvl[0].get_ref<const std::string&>());
+      qty_t s = scale_.parse_qty(lvl[1].get_ref<const std::string&>());
+      if (s>0) out.bids.emplace_back(p, s);
     }
     
     for (auto& lvl : j["asks"]) {
-      double p = std::stod(lvl[0].get<std::string>());
-      double s = std::stod(lvl[1].get<std::string>());
-      if (s>0) out_book.asks[p] = s;
+      px_t p = scale_.parse_px(lvl[0].get_ref<const std::string&>());
+      qty_t s = scale_.parse_qty(lvl[1].get_ref<const std::string&>());
+      if (s>0) out.asks.emplace_back(p, s);
     }
     return true;
   } catch (const std::exception& e) { 
@@ -81,39 +103,99 @@ bool BinanceAdapter::fetch_snapshot(
   }
 }
 
+namespace {
+// Whether an event with ids U..u (previous final id pu, futures streams
+// only) follows a book at last_update_id: by U/u window or by pu linkage.
+bool follows(long long U, long long u, long long pu, long long last_update_id) {
+  return (U <= last_update_id + 1 && last_update_id + 1 <= u) || (pu == last_update_id && pu != 0);
+}
+}  // namespace
+
 void BinanceAdapter::apply_update_json(
-    const std::string& payload, long long& last_update_id, OrderBook& book) {
-  auto j = json::parse(payload);
-  long long U = j.at("U").get<long long>();
-  long long u = j.at("u").get<long long>();
-  long long pu = j.contains("pu") ? j["pu"].get<long long>() : 0LL;
+    std::string_view payload, long long& last_update_id, OrderBook& book) {
+  // One pass over the frame: sequence ids and both sides' levels (pu may
+  // follow the levels, so they are collected before the checks).
+  std::pmr::memory_resource* mr = scratch();
+  std::pmr::vector<Delta> bid_d{mr}, ask_d{mr};
+  long long U = -1, u = -1, pu = 0;
+  bool has_U = false, has_u = false;
+
+  JsonCursor c(payload);
+  auto collect = [&](std::pmr::vector<Delta>& out) {
+    c.elements([&] {
+      px_t p = 0;
+      int n = 0;
+      c.elements([&] {
+        if (n == 0) p = book.scale.parse_px(c.scalar());
+        else if (n == 1) out.emplace_back(p, book.scale.parse_qty(c.scalar()));
+        ++n;
+      });
+    });
+  };
+  c.fields([&](std::string_view key) {
+    if (key == "U") { U = c.integer(); has_U = true; }
+    else if (key == "u") { u = c.integer(); has_u = true; }
+    else if (key == "pu") pu = c.integer();
+    else if (key == "b") collect(bid_d);
+    else if (key == "a") collect(ask_d);
+  });
+  if (!has_U || !has_u) throw std::runtime_error("depth update without U/u");
 
   if (u <= last_update_id) return;
 
-  // Accept if bridged by U/u window or by pu linkage; otherwise real gap.
-  bool bridged_window = (U <= last_update_id + 1 && last_update_id + 1 <= u);
-  bool bridged_pu = (pu == last_update_id && pu != 0);
-  if (!(bridged_window || bridged_pu)) {
-    throw std::runtime_error("sequence gap; need resnapshot");
-  }
+  if (!follows(U, u, pu, last_update_id)) throw SequenceGap("sequence gap; need resnapshot");
 
-  std::vector<std::pair<double,double>> bid_d, ask_d;
+  apply_levels(book, BookEvent::Kind::kBid, bid_d);
+  apply_levels(book, BookEvent::Kind::kAsk, ask_d);
+  last_update_id = u;
+}
 
-  for (auto& lvl: j["b"]) {
-    double p = std::stod(lvl[0].get<std::string>());
-    double s = std::stod(lvl[1].get<std::string>());
-    bid_d.emplace_back(p, s);
-  }
+// Fetch a snapshot on its own thread, after delay (skipped once stop() is called).
+std::future<BinanceAdapter::Snapshot> BinanceAdapter::fetch_snapshot_async(std::chrono::milliseconds delay) {
+  return std::async(std::launch::async, [this, delay] {
+    const auto until = std::chrono::steady_clock::now() + delay;
+    while (running() && std::chrono::steady_clock::now() < until)
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    Snapshot snap;
+    const auto t0 = std::chrono::steady_clock::now();
+    snap.ok = running() && fetch_snapshot(snap, snap.err);
+    snap.fetch_time = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t0);
+    return snap;
+  });
+}
 
-  for (auto& lvl: j["a"]) {
-    double p = std::stod(lvl[0].get<std::string>());
-    double s = std::stod(lvl[1].get<std::string>());
-    ask_d.emplace_back(p, s);
+// Install snap and replay the buffered events on top of it. Events the
+// snapshot already covers are skipped; the first one past it must straddle
+// lastUpdateId + 1. The chain of ids is checked first, reading only U/u/pu of
+// each event, so if the events do not bridge (the snapshot is older than the
+// oldest buffered event) book, journal and last_update_id are left as they
+// were, the events are kept, and false is returned; the caller fetches
+// another.
+bool BinanceAdapter::bridge(const Snapshot& snap, std::vector<std::string>& pending,
+                            long long& last_update_id, OrderBook& book) {
+  long long id = snap.last_update_id;
+  for (const auto& frame : pending) {
+    long long U = -1, u = -1, pu = 0;
+    bool has_U = false, has_u = false;
+    JsonCursor c(frame);
+    c.fields([&](std::string_view key) {
+      if (key == "U") { U = c.integer(); has_U = true; }
+      else if (key == "u") { u = c.integer(); has_u = true; }
+      else if (key == "pu") pu = c.integer();
+    });
+    if (!has_U || !has_u) throw std::runtime_error("depth update without U/u");
+    if (u <= id) continue;
+    if (!follows(U, u, pu, id)) return false;
+    id = u;
   }
 
-  apply_deltas(book.bids, bid_d);
-  apply_deltas(book.asks, ask_d);
-  last_update_id = u;
+  reset_book(book);
+  apply_levels(book, BookEvent::Kind::kBid, snap.bids);
+  apply_levels(book, BookEvent::Kind::kAsk, snap.asks);
+  last_update_id = snap.last_update_id;
+  for (const auto& frame : pending) apply_update_json(frame, last_update_id, book);
+  pending.clear();
+  return true;
 }
 
 void BinanceAdapter::run(Callback cb) {
@@ -121,7 +203,7 @@ void BinanceAdapter::run(Callback cb) {
 
   while (running()) {
     try {
-      OrderBook book;
+      OrderBook book{scale_, tick_, &book_pool_};
       long long last_id = 0;
 
       // 1) connect WS first
@@ -145,46 +227,67 @@ void BinanceAdapter::run(Callback cb) {
       ws.next_layer().handshake(ssl::stream_base::client);
       ws.handshake(host, path);
 
-      // 2) HTTP snapshot
-      std::string err;
-      if (!fetch_snapshot(book, last_id, err)) {
-        std::cerr << "[BINANCE] snapshot error: " << err << std::endl;
-        boost::system::error_code ec;
-        ws.close(boost::beast::websocket::close_code::normal, ec);
-        std::this_thread::sleep_for(1s);
-        continue;
-      }
-
-      // 3) Bridge buffered updates from WS using U/u or pu
+      // 2) Buffer the stream while the REST snapshot is fetched, bridge,
+      //    then apply it live; a gap goes back to buffering.
       boost::beast::flat_buffer buffer;
-      for (;;) {
-        buffer.clear();
-        ws.read(buffer);
-        std::string payload = boost::beast::buffers_to_string(buffer.data());
-        try {
-          auto before = last_id;
-          apply_update_json(payload, last_id, book);
-          if (last_id != before) { 
-            cb(book, "BINANCE");
-            break;
+      buffer.reserve(kWsFrameReserve);
+      std::vector<std::string> pending;
+      std::future<Snapshot> snap = fetch_snapshot_async(0ms);
+      auto gap_at = std::chrono::steady_clock::now();
+      bool synced_once = false;
+      auto refetch = kRefetchMin;
+
+      while (running()) {
+        if (snap.valid()) {
+          if (ws_frame_ready(ws, std::chrono::steady_clock::now() + 5ms)) {
+            buffer.clear();
+            ws.read(buffer);
+            pending.emplace_back(frame_view(buffer));
+            if (pending.size() > kMaxPendingFrames)
+              throw std::runtime_error("snapshot too slow, stream backlog full");
           }
-        } catch (const std::exception& e) {
+          if (snap.wait_for(0s) != std::future_status::ready) continue;
+
+          Snapshot s = snap.get();
+          if (!s.ok) {
+            std::cerr << "[BINANCE] snapshot error: " << s.err << std::endl;
+            snap = fetch_snapshot_async(1000ms);
+            continue;
+          }
+          last_snapshot_us_.store(s.fetch_time.count(), std::memory_order_relaxed);
+          if (!bridge(s, pending, last_id, book)) {
+            // The REST snapshot lags the stream; give it time to catch up.
+            snap = fetch_snapshot_async(refetch);
+            refetch = std::min(refetch * 2, kRefetchMax);
+            continue;
+          }
+          refetch = kRefetchMin;
+          if (synced_once) {
+            const auto took = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - gap_at);
+            last_recovery_us_.store(took.count(), std::memory_order_relaxed);
+            recoveries_.fetch_add(1, std::memory_order_relaxed);
+            std::cerr << "[BINANCE] resynced in " << took.count() / 1000 << " ms (snapshot "
+                      << s.fetch_time.count() / 1000 << " ms)" << std::endl;
+          }
+          synced_once = true;
+          publish(cb, book);
           continue;
         }
-      }
-
-      // 4) Steady-state WS consumption
-      for (;;) {
-        buffer.clear();
-        ws.read(buffer);
-        std::string payload = boost::beast::buffers_to_string(buffer.data());
 
         try {
-          apply_update_json(payload, last_id, book);
-          cb(book, "BINANCE");
-        } catch (const std::exception& e) {
-          std::cerr << "[BINANCE] " << e.what() << " — resyncing..." << std::endl;
-          break;
+          count_burst(ws_read_burst(ws, buffer, conflation_, [&](std::string_view frame) {
+            apply_update_json(frame, last_id, book);
+          }));
+          publish(cb, book);
+        } catch (const SequenceGap& e) {
+          // Keep the stream: the frame that gapped is the first one to bridge.
+          std::cerr << "[BINANCE] " << e.what() << " — resyncing on the open stream..." << std::endl;
+          publish(cb, book);
+          gap_at = std::chrono::steady_clock::now();
+          pending.clear();
+          pending.emplace_back(frame_view(buffer));
+          snap = fetch_snapshot_async(0ms);
         }
       }
 
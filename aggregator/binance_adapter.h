@@ -3,22 +3,80 @@
 #include <functional>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <future>
 #include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 #include "../common/order_book.h"
 #include "adapter_base.h"
 
+// Thrown by apply_update_json for an update that does not follow the book.
+struct SequenceGap : std::runtime_error {
+  using std::runtime_error::runtime_error;
+};
+
+// Sync follows Binance's local order book procedure: the stream is opened
+// first, its events are buffered while the REST snapshot is fetched on a
+// separate thread, then the snapshot is installed and the buffered events
+// bridged onto it by U/u. A sequence gap later on goes through the same
+// procedure on the open stream; the connection is only rebuilt when the
+// stream itself fails. Until the bridge completes the last published book
+// stays in place.
 class BinanceAdapter : public AdapterBase {
 public:
   using Callback = AdapterBase::Callback;
-  
-  explicit BinanceAdapter(std::string symbol = "BTCUSDT");
+
+  explicit BinanceAdapter(std::string symbol = "BTCUSDT", FixedScale scale = {},
+                          double price_tick = 0.01);
   ~BinanceAdapter();
 
+  const char* name() const override { return "BINANCE"; }
+
+  // Sequence gaps recovered on the open stream, and for the last one: time
+  // from the gap to the bridged book, and the REST snapshot round-trip
+  // within it.
+  std::uint64_t recoveries() const { return recoveries_.load(std::memory_order_relaxed); }
+  std::chrono::microseconds last_recovery() const {
+    return std::chrono::microseconds(last_recovery_us_.load(std::memory_order_relaxed));
+  }
+  std::chrono::microseconds last_snapshot_fetch() const {
+    return std::chrono::microseconds(last_snapshot_us_.load(std::memory_order_relaxed));
+  }
+
   using AdapterBase::start;
   using AdapterBase::stop;
 
 private:
+  // A REST depth snapshot, fetched off the adapter thread.
+  struct Snapshot {
+    bool ok{false};
+    std::string err;
+    long long last_update_id{0};
+    std::vector<Delta> bids, asks;
+    std::chrono::microseconds fetch_time{0};
+  };
+
   void run(Callback cb) override;
-  bool fetch_snapshot(OrderBook& out_book, long long& last_update_id, std::string& err);
-  void apply_update_json(const std::string& payload, long long& last_update_id, OrderBook& book);
+  bool fetch_snapshot(Snapshot& out, std::string& err);
+  std::future<Snapshot> fetch_snapshot_async(std::chrono::milliseconds delay);
+  bool bridge(const Snapshot& snap, std::vector<std::string>& pending, long long& last_update_id,
+              OrderBook& book);
+  void apply_update_json(std::string_view payload, long long& last_update_id, OrderBook& book);
+
+  // Stream events buffered while a snapshot is in flight; beyond this many
+  // the stream is dropped and reopened.
+  static constexpr std::size_t kMaxPendingFrames = 4096;
+  // Delay before fetching another snapshot after one that did not bridge,
+  // doubling on each further miss.
+  static constexpr std::chrono::milliseconds kRefetchMin{250};
+  static constexpr std::chrono::milliseconds kRefetchMax{2000};
+  // Longest a REST snapshot request may take, connect to last byte.
+  static constexpr std::chrono::seconds kSnapshotTimeout{5};
+
+  std::atomic<std::uint64_t> recoveries_{0};
+  std::atomic<std::int64_t> last_recovery_us_{0};
+  std::atomic<std::int64_t> last_snapshot_us_{0};
 };
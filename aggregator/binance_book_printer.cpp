@@ -24,7 +24,7 @@ void print_book(const OrderBook& book, std::size_t depth = 10) {
   std::size_t i = 0;
   for (const auto& [p, s] : book.bids) {
     if (i++ >= depth) break;
-    std::cout << p << "@" << s << "  ";
+    std::cout << book.scale.px_to_double(p) << "@" << book.scale.qty_to_double(s) << "  ";
   }
   if (i == 0) std::cout << "(empty)";
   std::cout << "\n";
@@ -33,7 +33,7 @@ void print_book(const OrderBook& book, std::size_t depth = 10) {
   i = 0;
   for (const auto& [p, s] : book.asks) {
     if (i++ >= depth) break;
-    std::cout << p << "@" << s << "  ";
+    std::cout << book.scale.px_to_double(p) << "@" << book.scale.qty_to_double(s) << "  ";
   }
   if (i == 0) std::cout << "(empty)";
   std::cout << "\n" << std::endl;
@@ -56,7 +56,7 @@ int main(int argc, char** argv) {
             << " (Ctrl+C to quit)" << std::endl;
 
   BinanceAdapter adapter(symbol);
-  adapter.start([](const OrderBook& book, const char*) {
+  adapter.start([](const OrderBook& book, VenueId) {
     print_book(book);
   });
 
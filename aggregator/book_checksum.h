@@ -0,0 +1,62 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include "../common/crc32.h"
+#include "../common/order_book.h"
+
+// Venue book checksums, computed from the adapter's own book so a missed or
+// misapplied update is caught on the next message that carries one. Each
+// number is rendered straight from fixed point into a stack buffer and fed to
+// the CRC as it is produced; no string is built.
+
+// OKX "checksum": CRC-32, as a signed int32, of the top 25 levels interleaved
+// bid, ask, bid, ask... as "price:size" pairs joined by ':'. A side that runs
+// out simply stops contributing. Numbers appear as OKX sends them: shortest
+// decimal, no trailing zeros.
+inline std::int32_t okx_checksum(const OrderBook& book) {
+  Crc32 crc;
+  char buf[48];
+  bool first = true;
+  auto level = [&](px_t p, qty_t q) {
+    std::size_t n = 0;
+    if (!first) buf[n++] = ':';
+    first = false;
+    n += format_fixed(p, book.scale.px_dp, buf + n);
+    buf[n++] = ':';
+    n += format_fixed(q, book.scale.qty_dp, buf + n);
+    crc.update(buf, n);
+  };
+  auto bid = book.bids.begin();
+  auto ask = book.asks.begin();
+  for (int i = 0; i < 25; ++i) {
+    const bool has_bid = bid != book.bids.end(), has_ask = ask != book.asks.end();
+    if (!has_bid && !has_ask) break;
+    if (has_bid) { level(bid->first, bid->second); ++bid; }
+    if (has_ask) { level(ask->first, ask->second); ++ask; }
+  }
+  return static_cast<std::int32_t>(crc.value());
+}
+
+// Kraken v2 "checksum": CRC-32 of the top 10 asks (best first), then the top
+// 10 bids (best first), each level as price then quantity, both printed at
+// the pair's precision with the decimal point and leading zeros removed; no
+// separators. px_precision and qty_precision are the pair's decimal places,
+// at most the book's own.
+inline std::uint32_t kraken_checksum(const OrderBook& book, int px_precision, int qty_precision) {
+  Crc32 crc;
+  const std::int64_t px_div = kPow10[book.scale.px_dp - px_precision];
+  const std::int64_t qty_div = kPow10[book.scale.qty_dp - qty_precision];
+  char buf[48];
+  auto side = [&](const auto& levels) {
+    int i = 0;
+    for (auto it = levels.begin(); it != levels.end() && i < 10; ++it, ++i) {
+      char* p = std::to_chars(buf, buf + 24, it->first / px_div).ptr;
+      p = std::to_chars(p, buf + sizeof buf, it->second / qty_div).ptr;
+      crc.update(buf, static_cast<std::size_t>(p - buf));
+    }
+  };
+  side(book.asks);
+  side(book.bids);
+  return crc.value();
+}
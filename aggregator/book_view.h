@@ -0,0 +1,188 @@
+#pragma once
+
+#include <grpcpp/grpcpp.h>
+#include "bookfeed.grpc.pb.h"   // SerializationTraits for the messages
+
+#include "../common/book_event.h"
+#include "../common/consolidator.h"
+#include "../common/order_book.h"
+#include "../common/packed_book.h"
+#include "../common/published.h"
+#include "../common/version_log.h"
+#include "../common/version_waiters.h"
+#include "adapter_base.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+
+// One consolidated version as it goes on the wire, in both encodings: each
+// message is built once (into recycled storage, so its Level objects and
+// packed arrays are reused) and serialized once; every stream writes the
+// bytes of the encoding it asked for.
+struct FeedVersion {
+  bookfeed::ConsolidatedBook msg;      // LEVELS
+  grpc::ByteBuffer bytes;
+  bookfeed::ConsolidatedBook packed;   // PACKED
+  grpc::ByteBuffer packed_bytes;
+
+  const grpc::ByteBuffer& wire(bookfeed::Encoding e) const {
+    return e == bookfeed::PACKED ? packed_bytes : bytes;
+  }
+};
+
+// One StreamBookDeltas step (the changes from version seq - 1 to seq),
+// serialized once and written by every delta stream that replays it.
+struct DeltaFrame {
+  grpc::ByteBuffer bytes;
+};
+
+// One consolidation of a symbol's venues (a bucket tick and a depth) and what
+// its subscribers read: the published versions, the delta log and the
+// streams parked for the next version. All subscribers asking for the same
+// tick and depth share one view.
+//
+// The buckets are not the view's own: every view at one tick reads the same
+// IncrementalConsolidator (see SymbolPipeline) and cuts it to its depth when
+// it publishes. publish() runs on the symbol's shard thread; the rest may be
+// used from any thread. A view with no subscribers does not publish, so
+// unused depth costs no emit or serialization. Each publish cuts the engine
+// into one of two FlatBooks the view keeps, and diffs it against the other,
+// so a published version costs O(topN) and, once warm, no allocation beyond
+// the frames it hands to streams.
+class BookView {
+public:
+  BookView(FixedScale scale, const ConsolidationCfg& cfg)
+    : cfg_(cfg), tick_(scale.tick_to_px(cfg.tick)) {}
+
+  BookView(const BookView&) = delete;
+  BookView& operator=(const BookView&) = delete;
+
+  const ConsolidationCfg& cfg() const { return cfg_; }
+  px_t tick() const { return tick_; }
+
+  // Shard thread: publish a new version from engine (this view's tick) if
+  // its topN changed since the last one and anyone is subscribed, and wake
+  // the parked streams. Returns whether it published. A change seen while
+  // nobody is subscribed is published once someone is.
+  bool publish(const IncrementalConsolidator& engine) {
+    if (!pending_ && !engine.touched(frontier_)) return false;
+    if (subscribers_.load(std::memory_order_relaxed) == 0) {
+      pending_ = true;
+      return false;
+    }
+    engine.emit(cfg_.topN, frontier_, next_);
+    pending_ = false;
+    publish_merged(next_);
+    std::swap(prev_, next_);
+    waiters_.wake_all(version_);
+    return true;
+  }
+  // Shard thread: the last published book and its version.
+  const FlatBook& book() const { return prev_; }
+  std::uint64_t version() const { return version_; }
+
+  std::shared_ptr<const FeedVersion> current() const { return merged_.load(); }
+  // Delta frames of the recent versions; a frame is logged before its version
+  // becomes current().
+  const VersionLog<DeltaFrame>& deltas() const { return deltas_; }
+  // Any thread: the changes from version `from` to version `to` as one
+  // BookDelta (base_seq = from), serialized into out. Each level changed in
+  // between appears once, with its size at `to`. Returns false if a frame in
+  // between has left the log.
+  bool merge_deltas(std::uint64_t from, std::uint64_t to, grpc::ByteBuffer& out) const {
+    std::map<double, double, std::greater<double>> bids;
+    std::map<double, double> asks;
+    bookfeed::BookDelta d;
+    for (std::uint64_t v = from + 1; v <= to; ++v) {
+      const auto frame = deltas_.at(v);
+      if (!frame) return false;
+      grpc::ByteBuffer bytes(frame->bytes);   // Deserialize consumes its buffer
+      if (!grpc::SerializationTraits<bookfeed::BookDelta>::Deserialize(&bytes, &d).ok()) return false;
+      for (const auto& l : d.bids()) bids[l.price()] = l.size();
+      for (const auto& l : d.asks()) asks[l.price()] = l.size();
+    }
+    const std::int64_t ts_ms = d.ts_ms();
+    d.Clear();
+    d.set_seq(to);
+    d.set_base_seq(from);
+    d.set_ts_ms(ts_ms);
+    for (const auto& [p, s] : bids) { auto* lv = d.add_bids(); lv->set_price(p); lv->set_size(s); }
+    for (const auto& [p, s] : asks) { auto* lv = d.add_asks(); lv->set_price(p); lv->set_size(s); }
+    bool own = false;
+    out.Clear();
+    return grpc::SerializationTraits<bookfeed::BookDelta>::Serialize(d, &out, &own).ok();
+  }
+  // Streams that have sent current() park here until the next version.
+  VersionWaiters& waiters() { return waiters_; }
+
+  // Counted by SymbolPipeline; unsubscribe() returns the subscribers left.
+  void subscribe() { subscribers_.fetch_add(1, std::memory_order_relaxed); }
+  std::size_t unsubscribe() { return subscribers_.fetch_sub(1, std::memory_order_relaxed) - 1; }
+  std::size_t subscribers() const { return subscribers_.load(std::memory_order_relaxed); }
+
+private:
+  void publish_merged(const FlatBook& merged) {
+    auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::uint64_t version = ++version_;
+    log_delta(merged, version, now_ms);
+    merged_.update([&](FeedVersion& v) {
+      auto& msg = v.msg;
+      msg.Clear();   // keeps the Level objects of a recycled version for reuse
+      msg.set_version(version);
+      msg.set_ts_ms(static_cast<int64_t>(now_ms));
+      const auto& sc = merged.scale;
+      for (const auto& [p,s] : merged.bids) {
+        auto* lv = msg.add_bids(); lv->set_price(sc.px_to_double(p)); lv->set_size(sc.qty_to_double(s));
+      }
+      for (const auto& [p,s] : merged.asks) {
+        auto* lv = msg.add_asks(); lv->set_price(sc.px_to_double(p)); lv->set_size(sc.qty_to_double(s));
+      }
+      bool own = false;
+      v.bytes.Clear();
+      grpc::SerializationTraits<bookfeed::ConsolidatedBook>::Serialize(msg, &v.bytes, &own);
+
+      auto& packed = v.packed;
+      packed.set_version(version);
+      packed.set_ts_ms(static_cast<int64_t>(now_ms));
+      pack_levels(merged, tick_, packed);
+      v.packed_bytes.Clear();
+      grpc::SerializationTraits<bookfeed::ConsolidatedBook>::Serialize(packed, &v.packed_bytes, &own);
+    });
+  }
+
+  // The levels that changed since the previously published version.
+  void log_delta(const FlatBook& merged, std::uint64_t version, std::int64_t now_ms) {
+    auto& d = delta_msg_;
+    d.Clear();
+    d.set_seq(version);
+    d.set_ts_ms(now_ms);
+    const auto& sc = merged.scale;
+    diff_sides<std::greater<px_t>>(prev_.bids, merged.bids, [&](px_t p, qty_t q) {
+      auto* lv = d.add_bids(); lv->set_price(sc.px_to_double(p)); lv->set_size(sc.qty_to_double(q));
+    });
+    diff_sides<std::less<px_t>>(prev_.asks, merged.asks, [&](px_t p, qty_t q) {
+      auto* lv = d.add_asks(); lv->set_price(sc.px_to_double(p)); lv->set_size(sc.qty_to_double(q));
+    });
+    auto frame = std::make_shared<DeltaFrame>();
+    bool own = false;
+    grpc::SerializationTraits<bookfeed::BookDelta>::Serialize(d, &frame->bytes, &own);
+    deltas_.append(version, std::move(frame));
+  }
+
+  const ConsolidationCfg cfg_;
+  const px_t tick_;
+  IncrementalConsolidator::Frontier frontier_;   // of the last publish; shard thread only
+  bool pending_{true};                           // publish even if untouched; shard thread only
+  std::uint64_t version_{0};
+  FlatBook prev_, next_;             // last published book and scratch, shard thread only
+  bookfeed::BookDelta delta_msg_;    // shard thread only
+  Published<FeedVersion> merged_;
+  VersionLog<DeltaFrame> deltas_{1024};
+  VersionWaiters waiters_;
+  std::atomic<std::size_t> subscribers_{0};
+};
@@ -0,0 +1,179 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Forward-only, on-demand reader over one JSON document held in caller
+// memory. Nothing is materialized: fields() and elements() walk an object or
+// array in place, handing each key (or element) to a callback that reads the
+// value it wants; values the callback does not read are skipped, so a frame is
+// scanned once, front to back, with no DOM, no allocation and no copies.
+// Strings come back as views into the document (escapes left as they are;
+// venue keys and numbers carry none). Malformed input throws
+// std::runtime_error, like a failed parse.
+//
+// A callback must read the value it was handed either completely (one
+// string()/number()/fields()/elements()/skip() call) or not at all.
+class JsonCursor {
+public:
+  enum class Type { kObject, kArray, kString, kNumber, kBool, kNull };
+
+  explicit JsonCursor(std::string_view doc) : p_(doc.data()), end_(doc.data() + doc.size()) {}
+
+  // Type of the next value.
+  Type type() {
+    ws();
+    switch (peek()) {
+      case '{': return Type::kObject;
+      case '[': return Type::kArray;
+      case '"': return Type::kString;
+      case 't': case 'f': return Type::kBool;
+      case 'n': return Type::kNull;
+      default: return Type::kNumber;
+    }
+  }
+
+  // Object: f(std::string_view key) for each member, in document order.
+  template <class F>
+  void fields(F&& f) {
+    ws();
+    expect('{');
+    ws();
+    if (peek() == '}') { ++p_; return; }
+    for (;;) {
+      ws();
+      const std::string_view key = raw_string();
+      ws();
+      expect(':');
+      ws();
+      const char* at = p_;
+      f(key);
+      if (p_ == at) skip();
+      ws();
+      if (peek() == '}') { ++p_; return; }
+      expect(',');
+    }
+  }
+
+  // Array: f() for each element, in order.
+  template <class F>
+  void elements(F&& f) {
+    ws();
+    expect('[');
+    ws();
+    if (peek() == ']') { ++p_; return; }
+    for (;;) {
+      ws();
+      const char* at = p_;
+      f();
+      if (p_ == at) skip();
+      ws();
+      if (peek() == ']') { ++p_; return; }
+      expect(',');
+    }
+  }
+
+  std::string_view string() {
+    ws();
+    return raw_string();
+  }
+
+  // The text of a number, or the contents of a string (venues quote their
+  // decimals). Throws for anything else.
+  std::string_view scalar() {
+    ws();
+    if (peek() == '"') return raw_string();
+    const char* b = p_;
+    while (p_ != end_ && is_number_char(*p_)) ++p_;
+    if (p_ == b) fail("expected a number");
+    return {b, static_cast<std::size_t>(p_ - b)};
+  }
+
+  // A number (or numeric string) as a double, parsed without locale.
+  double number() {
+    const std::string_view s = scalar();
+    double v = 0;
+    const auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (r.ec != std::errc{} || r.ptr != s.data() + s.size()) fail("bad number");
+    return v;
+  }
+
+  std::int64_t integer() {
+    const std::string_view s = scalar();
+    std::int64_t v = 0;
+    const auto r = std::from_chars(s.data(), s.data() + s.size(), v);
+    if (r.ec != std::errc{} || r.ptr != s.data() + s.size()) fail("bad integer");
+    return v;
+  }
+
+  // Step over the next value, whatever it is.
+  void skip() {
+    switch (type()) {
+      case Type::kString: raw_string(); return;
+      case Type::kNumber: scalar(); return;
+      case Type::kBool: literal(peek() == 't' ? "true" : "false"); return;
+      case Type::kNull: literal("null"); return;
+      case Type::kObject: case Type::kArray: break;
+    }
+    // Containers: count brackets, stepping over strings whole.
+    int depth = 0;
+    do {
+      switch (peek()) {
+        case '"': raw_string(); continue;
+        case '{': case '[': ++depth; break;
+        case '}': case ']': --depth; break;
+        default: break;
+      }
+      ++p_;
+    } while (depth > 0);
+  }
+
+private:
+  static bool is_number_char(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+  }
+
+  [[noreturn]] static void fail(const char* what) {
+    throw std::runtime_error(std::string("json: ") + what);
+  }
+
+  char peek() const {
+    if (p_ == end_) fail("unexpected end");
+    return *p_;
+  }
+  void expect(char c) {
+    if (peek() != c) fail("unexpected character");
+    ++p_;
+  }
+  void ws() {
+    while (p_ != end_ && (*p_ == ' ' || *p_ == '\n' || *p_ == '\r' || *p_ == '\t')) ++p_;
+  }
+  void literal(std::string_view word) {
+    if (static_cast<std::size_t>(end_ - p_) < word.size() || std::memcmp(p_, word.data(), word.size()) != 0)
+      fail("bad literal");
+    p_ += word.size();
+  }
+
+  // The contents of the string at p_; memchr finds the closing quote (the
+  // libc's vectorized search), then escaped quotes are stepped over.
+  std::string_view raw_string() {
+    expect('"');
+    const char* b = p_;
+    for (;;) {
+      const auto* q = static_cast<const char*>(std::memchr(p_, '"', static_cast<std::size_t>(end_ - p_)));
+      if (!q) fail("unterminated string");
+      std::size_t slashes = 0;
+      for (const char* s = q; s != b && s[-1] == '\\'; --s) ++slashes;
+      p_ = q + 1;
+      if (slashes % 2 == 0) return {b, static_cast<std::size_t>(q - b)};
+    }
+  }
+
+  const char* p_;
+  const char* end_;
+};
@@ -1,4 +1,7 @@
 #include "kraken_adapter.h"
+#include "book_checksum.h"
+#include "json_cursor.h"
+#include "ws_conflation.h"
 #include <boost/asio.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/ssl.hpp>
@@ -7,6 +10,8 @@
 #include <boost/asio/ssl/context.hpp>
 #include <nlohmann/json.hpp>
 #include <iostream>
+#include <algorithm>
+#include <iterator>
 #include <chrono>
 
 using tcp = boost::asio::ip::tcp;
@@ -15,7 +20,13 @@ namespace http = boost::beast::http;
 using json = nlohmann::json;
 
 
-KrakenAdapter::KrakenAdapter(std::string symbol) : AdapterBase(std::move(symbol)){}
+KrakenAdapter::KrakenAdapter(std::string symbol, FixedScale scale, double price_tick)
+  : AdapterBase(std::move(symbol), scale, price_tick) {
+  // The checksum prints prices at the pair's precision: the decimals of its tick.
+  px_precision_ = scale_.px_dp;
+  for (px_t t = tick_; t % 10 == 0 && px_precision_ > 0; t /= 10) --px_precision_;
+  qty_precision_ = std::min(qty_precision_, scale_.qty_dp);
+}
 KrakenAdapter::~KrakenAdapter(){ stop(); }
 
 
@@ -99,26 +110,25 @@ bool KrakenAdapter::fetch_snapshot(OrderBook& out_book, std::string& err) {
     }
     auto& payload = it.value();
 
-    out_book.bids.clear();
-    out_book.asks.clear();
+    reset_book(out_book);
 
     if (payload.contains("bids")) {
       for (auto& lvl : payload["bids"]) {
-        double p = lvl[0].is_string() ?
-          std::stod(lvl[0].get<std::string>()) : lvl[0].get<double>();
-        double s = lvl[1].is_string() ?
-          std::stod(lvl[1].get<std::string>()) : lvl[1].get<double>();
-        if (s>0) out_book.bids[p] = s;
+        px_t p = lvl[0].is_string() ? out_book.scale.parse_px(lvl[0].get_ref<const std::string&>())
+                                    : out_book.scale.to_px(lvl[0].get<double>());
+        qty_t s = lvl[1].is_string() ? out_book.scale.parse_qty(lvl[1].get_ref<const std::string&>())
+                                     : out_book.scale.to_qty(lvl[1].get<double>());
+        if (s>0) set_level(out_book, BookEvent::Kind::kBid, p, s);
       }
     }
 
     if (payload.contains("asks")) {
       for (auto& lvl : payload["asks"]) {
-        double p = lvl[0].is_string() ?
-          std::stod(lvl[0].get<std::string>()) : lvl[0].get<double>();
-        double s = lvl[1].is_string() ?
-          std::stod(lvl[1].get<std::string>()) : lvl[1].get<double>();
-        if (s>0) out_book.asks[p] = s;
+        px_t p = lvl[0].is_string() ? out_book.scale.parse_px(lvl[0].get_ref<const std::string&>())
+                                    : out_book.scale.to_px(lvl[0].get<double>());
+        qty_t s = lvl[1].is_string() ? out_book.scale.parse_qty(lvl[1].get_ref<const std::string&>())
+                                     : out_book.scale.to_qty(lvl[1].get<double>());
+        if (s>0) set_level(out_book, BookEvent::Kind::kAsk, p, s);
       }
     }
     return true;
@@ -129,67 +139,85 @@ bool KrakenAdapter::fetch_snapshot(OrderBook& out_book, std::string& err) {
 }
 
 void KrakenAdapter::apply_ws_message(
-  const std::string& payload, OrderBook& book) {
-  auto j = json::parse(payload);
-  if (!j.is_object()) return;
-
-  if (!j.contains("channel")) return;
-  if (j["channel"].get<std::string>() != "book") return;
-  if (!j.contains("type") || !j.contains("data")) return;
-
-  std::string type = j["type"].get<std::string>();
-  auto data = j["data"];
-  if (!data.is_array() || data.empty()) return;
-
-  auto book_obj = data[0];
+  std::string_view payload, OrderBook& book) {
+  // One pass: levels of the first data entry are collected while scanning and
+  // applied once channel and type are known.
+  std::pmr::memory_resource* mr = scratch();
+  std::pmr::vector<Delta> bid_d{mr}, ask_d{mr};
+  std::string_view channel, type;
+  bool has_entry = false, has_checksum = false;
+  std::uint32_t checksum = 0;
+
+  JsonCursor c(payload);
+  if (c.type() != JsonCursor::Type::kObject) return;
+
+  auto collect = [&](std::pmr::vector<Delta>& out) {
+    if (c.type() != JsonCursor::Type::kArray) return;
+    c.elements([&] {
+      bool has_p = false, has_q = false;
+      px_t p = 0;
+      qty_t q = 0;
+      c.fields([&](std::string_view key) {
+        if (key == "price") { p = book.scale.parse_px(c.scalar()); has_p = true; }
+        else if (key == "qty") { q = book.scale.parse_qty(c.scalar()); has_q = true; }
+      });
+      if (!has_p || !has_q) throw std::runtime_error("kraken level without price/qty");
+      out.emplace_back(p, q);
+    });
+  };
+
+  c.fields([&](std::string_view key) {
+    if (key == "channel") channel = c.string();
+    else if (key == "type") type = c.string();
+    else if (key == "data" && c.type() == JsonCursor::Type::kArray) {
+      bool first = true;
+      c.elements([&] {
+        if (!first || c.type() != JsonCursor::Type::kObject) return;
+        first = false;
+        has_entry = true;
+        c.fields([&](std::string_view k) {
+          if (k == "bids") collect(bid_d);
+          else if (k == "asks") collect(ask_d);
+          else if (k == "checksum" && c.type() == JsonCursor::Type::kNumber) {
+            checksum = static_cast<std::uint32_t>(c.integer());
+            has_checksum = true;
+          }
+        });
+      });
+    }
+  });
+  if (channel != "book" || !has_entry) return;
 
   if (type == "snapshot") {
-    book.bids.clear();
-    book.asks.clear();
-    if (book_obj.contains("bids")) {
-      for (auto &lvl: book_obj["bids"]) {
-        double p = lvl["price"].is_string() ?
-          std::stod(lvl["price"].get<std::string>()) : lvl["price"].get<double>();
-        double q = lvl["qty"].is_string() ?
-          std::stod(lvl["qty"].get<std::string>()) : lvl["qty"].get<double>();
-        if (q>0) book.bids[p] = q;
-      }
-    }
-    
-    if (book_obj.contains("asks")) {
-      for (auto &lvl: book_obj["asks"]) {
-        double p = lvl["price"].is_string() ?
-          std::stod(lvl["price"].get<std::string>()) : lvl["price"].get<double>();
-        double q = lvl["qty"].is_string() ?
-          std::stod(lvl["qty"].get<std::string>()) : lvl["qty"].get<double>();
-        if (q>0) book.asks[p] = q;
-      }
-    }
+    reset_book(book);
+    for (const auto& [p, q] : bid_d) if (q > 0) set_level(book, BookEvent::Kind::kBid, p, q);
+    for (const auto& [p, q] : ask_d) if (q > 0) set_level(book, BookEvent::Kind::kAsk, p, q);
     got_ws_snapshot = true;
   } else if (type == "update") {
     if (!got_ws_snapshot) return;
+    apply_levels(book, BookEvent::Kind::kBid, bid_d);
+    apply_levels(book, BookEvent::Kind::kAsk, ask_d);
+    // Kraken does not delete levels pushed out past the subscribed depth.
+    truncate(book, book.bids, BookEvent::Kind::kBid);
+    truncate(book, book.asks, BookEvent::Kind::kAsk);
+  } else {
+    return;
+  }
 
-    if (book_obj.contains("bids")) {
-      for (auto &lvl: book_obj["bids"]) {
-        double p = lvl["price"].is_string() ?
-          std::stod(lvl["price"].get<std::string>()) : lvl["price"].get<double>();
-        double q = lvl["qty"].is_string() ?
-          std::stod(lvl["qty"].get<std::string>()) : lvl["qty"].get<double>();
-        if (q == 0) book.bids.erase(p);
-        else book.bids[p] = q;
-      }
-    }
+  if (has_checksum && kraken_checksum(book, px_precision_, qty_precision_) != checksum) {
+    std::cerr << "[KRAKEN][WS] " << symbol_ << ": checksum mismatch, resubscribing" << std::endl;
+    invalidate_book(book);
+    got_ws_snapshot = false;
+  }
+}
 
-    if (book_obj.contains("asks")) {
-      for (auto &lvl: book_obj["asks"]) {
-        double p = lvl["price"].is_string() ?
-          std::stod(lvl["price"].get<std::string>()) : lvl["price"].get<double>();
-        double q = lvl["qty"].is_string() ?
-          std::stod(lvl["qty"].get<std::string>()) : lvl["qty"].get<double>();
-        if (q == 0) book.asks.erase(p);
-        else book.asks[p] = q;
-      }
-    }
+// Remove the levels beyond kDepth on one side, worst first.
+template <class Side>
+void KrakenAdapter::truncate(OrderBook& book, const Side& side, BookEvent::Kind kind) {
+  while (side.size() > kDepth) {
+    auto it = side.begin();
+    std::advance(it, kDepth);
+    set_level(book, kind, it->first, 0);
   }
 }
 
@@ -246,24 +274,32 @@ void KrakenAdapter::run(Callback cb) {
 
       std::string ws_sym = normalize_symbol_for_ws(symbol_);
       params["symbol"] = json::array({ ws_sym });
-      params["depth"] = 100;
+      params["depth"] = kDepth;
       params["snapshot"] = true;
       sub["params"] = params;
 
-      std::string sub_msg = sub.dump();
+      const std::string sub_msg = sub.dump();
+      sub["method"] = "unsubscribe";
+      params.erase("snapshot");
+      sub["params"] = params;
+      const std::string unsub_msg = sub.dump();
       ws.write(boost::asio::buffer(sub_msg));
 
-      OrderBook book;
+      OrderBook book{scale_, tick_, &book_pool_};
       got_ws_snapshot = false;
       boost::beast::flat_buffer buffer;
+      buffer.reserve(kWsFrameReserve);
       while (running()) {
-        buffer.clear();
-        ws.read(buffer);
-        std::string payload = boost::beast::buffers_to_string(buffer.data());
-
         try {
-          apply_ws_message(payload, book);
-          cb(book, "KRAKEN");
+          count_burst(ws_read_burst(ws, buffer, conflation_, [&](std::string_view frame) {
+            apply_ws_message(frame, book);
+          }));
+          if (take_resubscribe()) {
+            // Only the channel is redone; the connection stays up.
+            ws.write(boost::asio::buffer(unsub_msg));
+            ws.write(boost::asio::buffer(sub_msg));
+          }
+          publish(cb, book);
         } catch (const std::exception& e) {
           std::cerr << "[KRAKEN][WS] apply error: " 
             << e.what() << " — resyncing" << std::endl;
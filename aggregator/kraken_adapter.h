@@ -4,6 +4,8 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <cstddef>
+#include <string_view>
 #include "../common/order_book.h"
 #include "adapter_base.h"
 
@@ -11,18 +13,29 @@ class KrakenAdapter : public AdapterBase {
 public:
   using Callback = AdapterBase::Callback;
 
-  explicit KrakenAdapter(std::string symbol = "XBTUSDT");
+  explicit KrakenAdapter(std::string symbol = "XBTUSDT", FixedScale scale = {},
+                         double price_tick = 0.1);
   ~KrakenAdapter();
 
+  const char* name() const override { return "KRAKEN"; }
+
   using AdapterBase::start;
   using AdapterBase::stop;
 
 private:
   void run(Callback cb) override;
   bool fetch_snapshot(OrderBook& out_book, std::string& err);
-  void apply_ws_message(const std::string& payload, OrderBook& book);
+  void apply_ws_message(std::string_view payload, OrderBook& book);
+  template <class Side>
+  void truncate(OrderBook& book, const Side& side, BookEvent::Kind kind);
 
   std::string normalize_symbol_for_ws(const std::string& in) const;
   bool got_ws_snapshot{false};
+
+  static constexpr std::size_t kDepth = 100;   // subscribed book depth
+  // Decimal places the checksum prints prices and quantities at. Kraken spot
+  // quantities carry 8.
+  int px_precision_{0};
+  int qty_precision_{8};
 };
 
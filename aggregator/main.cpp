@@ -1,159 +1,434 @@
 #include <grpcpp/grpcpp.h>
+#include <grpcpp/alarm.h>
 #include "bookfeed.grpc.pb.h"
 
-#include "../common/order_book.h"
-#include "../common/consolidator.h"
-#include "binance_adapter.h"
-#include "okx_adapter.h"
-#include "kraken_adapter.h"
+#include "shard_pool.h"
+#include "symbol_pipeline.h"
 
-#include <mutex>
-#include <thread>
 #include <atomic>
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
-#include <array>
-#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 static constexpr bool debug_mode = true;
 
-class BookFeedService final : public bookfeed::BookFeed::Service {
+// Adapters apply every frame already buffered on the socket before pushing one
+// message; no extra waiting window.
+static constexpr AdapterBase::Conflation kConflation{true, std::chrono::microseconds{0}};
+
+// Symbols served; SubscribeRequest.symbol selects one (empty -> the first).
+static std::vector<SymbolSpec> symbol_table() {
+  return {
+    {"BTCUSDT",
+     {{VenueKind::kBinance, "BTCUSDT", 0.01},
+      {VenueKind::kOkx, "BTC-USDT", 0.1},
+      {VenueKind::kKraken, "BTC-USDT", 0.1}},
+     FixedScale{8, 8}, {0.1, 200}},
+    {"ETHUSDT",
+     {{VenueKind::kBinance, "ETHUSDT", 0.01},
+      {VenueKind::kOkx, "ETH-USDT", 0.01},
+      {VenueKind::kKraken, "ETH-USDT", 0.01}},
+     FixedScale{8, 8}, {0.01, 200}},
+  };
+}
+
+// Relay mode: with AGG_UPSTREAM=host:port set, the same symbols are served
+// from that aggregator's StreamBook instead of from the exchanges. Each
+// symbol then has one venue, the upstream's consolidated book at the
+// symbol's tick.
+static std::vector<SymbolSpec> relay_table(const std::string& upstream) {
+  auto symbols = symbol_table();
+  for (auto& spec : symbols)
+    spec.venues = {{VenueKind::kUpstream, spec.symbol, spec.cfg.tick, upstream}};
+  return symbols;
+}
+
+// A positive integer from the environment, or 0 if unset or not one.
+static long env_count(const char* name) {
+  const char* env = std::getenv(name);
+  const long n = env ? std::strtol(env, nullptr, 10) : 0;
+  return n > 0 ? n : 0;
+}
+
+// Shard threads: AGG_SHARDS if set, else one per core left after the adapter
+// threads' share, at most one per symbol.
+static std::size_t shard_count(std::size_t symbols) {
+  if (const long n = env_count("AGG_SHARDS")) return static_cast<std::size_t>(n);
+  const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  return std::max<std::size_t>(1, std::min(symbols, cores / 2));
+}
+
+// Minimum spacing between two writes to one stream: AGG_MIN_INTERVAL_MS if
+// set (0: every new version is sent as soon as the previous write is done),
+// else 200 ms, the cadence the server always streamed at.
+static std::chrono::milliseconds min_interval() {
+  const char* env = std::getenv("AGG_MIN_INTERVAL_MS");
+  if (!env || !*env) return std::chrono::milliseconds(200);
+  return std::chrono::milliseconds(std::max(0L, std::strtol(env, nullptr, 10)));
+}
+
+// Shared-memory publication for readers on this host: with AGG_SHM_PREFIX
+// set, each symbol's default book is also written to /<prefix>-<symbol>.
+static std::string shm_prefix() {
+  const char* env = std::getenv("AGG_SHM_PREFIX");
+  return env ? env : "";
+}
+
+// Concurrent streams admitted: AGG_MAX_STREAMS if set, else 10000. Beyond it
+// new subscriptions fail with RESOURCE_EXHAUSTED.
+static std::size_t max_streams() {
+  const long n = env_count("AGG_MAX_STREAMS");
+  return n ? static_cast<std::size_t>(n) : 10000;
+}
+
+// Both RPCs are served through the raw callback API: a stream is a reactor
+// driven by write completions and new versions, not a thread, so gRPC's small
+// callback pool serves any number of them. Streams write the shared
+// pre-serialized ByteBuffers instead of re-serializing messages, and hold
+// only the version they are writing, so memory per stream is flat.
+class BookFeedService final
+    : public bookfeed::BookFeed::WithRawCallbackMethod_StreamBook<
+          bookfeed::BookFeed::WithRawCallbackMethod_StreamBookDeltas<bookfeed::BookFeed::Service>> {
 public:
-  BookFeedService() {
-    binance_ = std::make_unique<BinanceAdapter>("BTCUSDT");
-    binance_->start([this](const OrderBook& b, const char* venue){
-        onVenueUpdate(b, venue); });
-    
-    okx_ = std::make_unique<OKXAdapter>("BTC-USDT");
-    okx_->start([this](const OrderBook& b, const char* venue) { 
-        onVenueUpdate(b, venue); });
-
-    kraken_ = std::make_unique<KrakenAdapter>("BTC-USDT");
-    kraken_->start([this](const OrderBook& b, const char* venue){ 
-        onVenueUpdate(b, venue); });
+  BookFeedService(std::vector<SymbolSpec> symbols, std::size_t shards,
+                  std::chrono::milliseconds min_interval, std::size_t max_streams,
+                  const std::string& shm_prefix)
+    : min_interval_(min_interval), max_streams_(max_streams), pool_(shards, true) {
+    // The registry is built here and never changes, so lookups need no lock.
+    for (auto& spec : symbols) {
+      auto p = std::make_unique<SymbolPipeline>(std::move(spec), kConflation);
+      SymbolPipeline* raw = p.get();
+      const std::size_t shard = pool_.add([raw] { return raw->poll(); });
+      std::cout << "[AGG] " << raw->spec().symbol << " -> shard " << shard << std::endl;
+      if (!shm_prefix.empty()) {
+        raw->publish_shm("/" + shm_prefix + "-" + raw->spec().symbol);
+        std::cout << "[AGG] " << raw->spec().symbol << " -> shm /" << shm_prefix << "-"
+                  << raw->spec().symbol << std::endl;
+      }
+      if (!default_) default_ = raw;
+      registry_.emplace(raw->spec().symbol, raw);
+      pipelines_.push_back(std::move(p));
+    }
+    for (auto& p : pipelines_) p->start();
+    pool_.start();
   }
 
   ~BookFeedService() override {
-    if (binance_) binance_->stop();
-    if (okx_) okx_->stop();
-    if (kraken_) kraken_->stop();
+    for (auto& p : pipelines_) p->stop();
+    pool_.stop();
+  }
+
+  grpc::ServerWriteReactor<grpc::ByteBuffer>* StreamBook(grpc::CallbackServerContext*,
+                                                         const grpc::ByteBuffer* request) override {
+    bookfeed::SubscribeRequest req;
+    Subscription sub;
+    grpc::Status st;
+    if (!open(request, req, sub, st)) return new Rejected(std::move(st));
+    return new BookStream(sub, req.encoding(), live_);
+  }
+
+  grpc::ServerWriteReactor<grpc::ByteBuffer>* StreamBookDeltas(grpc::CallbackServerContext*,
+                                                               const grpc::ByteBuffer* request) override {
+    bookfeed::SubscribeRequest req;
+    Subscription sub;
+    grpc::Status st;
+    if (!open(request, req, sub, st)) return new Rejected(std::move(st));
+    return new DeltaStream(sub, live_);
+  }
+
+private:
+  // What a stream follows: its symbol, the symbol's view for the requested
+  // consolidation, and the stream's write spacing.
+  struct Subscription {
+    SymbolPipeline* pipeline{nullptr};
+    std::shared_ptr<BookView> view;   // counted as subscribed
+    std::chrono::milliseconds min_interval{0};
+  };
+
+  // Resolve a SubscribeRequest: symbol, depth, tick and interval (0 = the
+  // server's setting). Returns false with st set if it cannot be served.
+  bool subscribe(const grpc::ByteBuffer* request, bookfeed::SubscribeRequest& req,
+                 Subscription& sub, grpc::Status& st) const {
+    grpc::ByteBuffer copy(*request);
+    if (!grpc::SerializationTraits<bookfeed::SubscribeRequest>::Deserialize(&copy, &req).ok()) {
+      st = grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "bad SubscribeRequest");
+      return false;
+    }
+    sub.pipeline = route(req.symbol());
+    if (!sub.pipeline) {
+      st = grpc::Status(grpc::StatusCode::NOT_FOUND, "unknown symbol " + req.symbol());
+      return false;
+    }
+    try {
+      sub.view = sub.pipeline->subscribe(ConsolidationCfg{req.tick(), req.depth()});
+    } catch (const std::invalid_argument& e) {
+      st = grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, e.what());
+      return false;
+    }
+    if (!sub.view) {
+      st = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "too many distinct depth/tick settings");
+      return false;
+    }
+    sub.min_interval = req.interval_ms() ? std::chrono::milliseconds(req.interval_ms()) : min_interval_;
+    return true;
+  }
+
+  // subscribe(), then admit(); a request refused by either holds nothing.
+  bool open(const grpc::ByteBuffer* request, bookfeed::SubscribeRequest& req, Subscription& sub,
+            grpc::Status& st) {
+    if (!subscribe(request, req, sub, st)) return false;
+    if (admit(st)) return true;
+    sub.pipeline->release(*sub.view);
+    return false;
   }
 
-  grpc::Status StreamBook(grpc::ServerContext* ctx,
-                          const bookfeed::SubscribeRequest*,
-                          grpc::ServerWriter<bookfeed::ConsolidatedBook>* writer) override {
-    while (!ctx->IsCancelled()) {
-      bookfeed::ConsolidatedBook msg;
-      {
-        std::lock_guard<std::mutex> lk(mu_);
-
-        // --- Debug: print per-venue BBOs and source count ---
-        if constexpr (debug_mode) {
-          auto bb = [](const OrderBook& ob){
-            double bid_p=0.0, bid_s=0.0, ask_p=0.0, ask_s=0.0;
-            if (!ob.bids.empty()) { 
-              bid_p = ob.bids.begin()->first;
-              bid_s = ob.bids.begin()->second;
-            }
-            if (!ob.asks.empty()) { 
-              ask_p = ob.asks.begin()->first;
-              ask_s = ob.asks.begin()->second;
-            }
-            return std::array<double,4>{bid_p,bid_s,ask_p,ask_s};
-          };
-          
-          auto b1 = bb(book_binance_);
-          auto b2 = bb(book_okx_);
-          auto b3 = bb(book_kraken_);
-
-          int sources = 0;
-          if (!book_binance_.bids.empty() || !book_binance_.asks.empty()) ++sources;
-          if (!book_okx_.bids.empty()     || !book_okx_.asks.empty())     ++sources;
-          if (!book_kraken_.bids.empty()  || !book_kraken_.asks.empty())  ++sources;
-
-          auto _flags = std::cout.flags();
-          auto _prec  = std::cout.precision();
-          std::cout.setf(std::ios::fixed);
-          std::cout << std::setprecision(6);
-          std::cout << "[AGG] src BBOs [bid/ask]  BINANCE " << b1[0] << "@" << b1[1] << "/" << b1[2] << "@" << b1[3]
-                    << "  OKX " << b2[0] << "@" << b2[1] << "/" << b2[2] << "@" << b2[3]
-                    << "  KRAKEN " << b3[0] << "@" << b3[1] << "/" << b3[2] << "@" << b3[3]
-                    << "  (sources=" << sources << "/3)" << std::endl;
-          std::cout.flags(_flags);
-          std::cout.precision(_prec);
+  // Count a new stream in, unless max_streams_ are already live.
+  bool admit(grpc::Status& st) {
+    if (live_.fetch_add(1, std::memory_order_relaxed) < max_streams_) return true;
+    live_.fetch_sub(1, std::memory_order_relaxed);
+    st = grpc::Status(grpc::StatusCode::RESOURCE_EXHAUSTED, "too many streams");
+    return false;
+  }
+
+  SymbolPipeline* route(const std::string& symbol) const {
+    if (symbol.empty()) return default_;
+    auto it = registry_.find(symbol);
+    return it == registry_.end() ? nullptr : it->second;
+  }
+
+  const std::chrono::milliseconds min_interval_;
+  const std::size_t max_streams_;
+  std::atomic<std::size_t> live_{0};   // streams admitted and not yet done
+  std::vector<std::unique_ptr<SymbolPipeline>> pipelines_;
+  std::unordered_map<std::string, SymbolPipeline*> registry_;
+  SymbolPipeline* default_{nullptr};
+  ShardPool pool_;
+
+  class Rejected final : public grpc::ServerWriteReactor<grpc::ByteBuffer> {
+  public:
+    explicit Rejected(grpc::Status s) { Finish(std::move(s)); }
+    void OnDone() override { delete this; }
+  };
+
+  // One subscriber, as a sequence of writes that follows its symbol's
+  // versions. Writes each new version as soon as it is out, but no sooner than
+  // min_interval after the write that last caught the stream up; a version
+  // held back by the interval goes out when it expires (trailing send), so
+  // the final state always reaches the client. With nothing new to write the
+  // stream parks on the pipeline's VersionWaiters and holds no thread.
+  //
+  // Exactly one of {write in flight, alarm armed, parked} is pending at a
+  // time, and whichever completes next notices cancellation and calls
+  // Finish(), so Finish() is reached exactly once. Subclasses decide what a
+  // write carries (take()) and must call begin() at the end of construction.
+  class VersionStream : public grpc::ServerWriteReactor<grpc::ByteBuffer>,
+                        private VersionWaiters::Waiter {
+  public:
+    void OnWriteDone(bool ok) override {
+      std::unique_lock<std::mutex> lk(mu_);
+      if (!ok) cancelled_ = true;
+      next(lk);
+    }
+
+    void OnCancel() override {
+      std::unique_lock<std::mutex> lk(mu_);
+      cancelled_ = true;
+      if (state_ == State::kTimer) alarm_->Cancel();   // the alarm callback then finishes
+      else if (state_ == State::kParked && view_->waiters().unpark(this)) next(lk);
+      // otherwise OnWriteDone or on_version() is on its way and finishes
+    }
+
+    void OnDone() override {
+      pipeline_.release(*view_);
+      live_.fetch_sub(1, std::memory_order_relaxed);
+      delete this;
+    }
+
+  protected:
+    VersionStream(const Subscription& sub, std::atomic<std::size_t>& live)
+      : pipeline_(*sub.pipeline), view_(sub.view), min_interval_(sub.min_interval), live_(live) {}
+    virtual ~VersionStream() = default;
+
+    void begin() {
+      std::unique_lock<std::mutex> lk(mu_);
+      next(lk);
+    }
+
+    // With mu_ held and a version newer than sent out: the bytes to write
+    // next, which must stay valid until the write completes. Sets sent to the
+    // version the client has after this write, and caught_up to whether
+    // that is the latest one.
+    virtual const grpc::ByteBuffer* take(std::uint64_t& sent, bool& caught_up) = 0;
+
+    SymbolPipeline& pipeline_;
+    const std::shared_ptr<BookView> view_;   // subscribed until OnDone
+
+  private:
+    enum class State { kWriting, kTimer, kParked, kDone };
+
+    void on_version() override {
+      std::unique_lock<std::mutex> lk(mu_);
+      next(lk);
+    }
+
+    void on_alarm(bool fired) {
+      std::unique_lock<std::mutex> lk(mu_);
+      if (!fired) cancelled_ = true;
+      next(lk);
+    }
+
+    // The pending step has completed: decide the next one with mu_ held.
+    // Writes and Finish() are started after unlocking.
+    void next(std::unique_lock<std::mutex>& lk) {
+      if (cancelled_) {
+        state_ = State::kDone;
+        lk.unlock();
+        Finish(grpc::Status::OK);
+        return;
+      }
+      for (;;) {
+        // A delta stream can be ahead of current(): frames are logged before
+        // their version is published, and it may have sent one in between.
+        if (view_->current()->msg.version() <= sent_) {
+          state_ = State::kParked;
+          if (view_->waiters().park(this, sent_)) return;
+          continue;   // a newer version came out meanwhile
         }
-        // --- End debug ---
-
-        auto merged = consolidate({book_binance_, book_okx_, book_kraken_}, cfg_);
-
-        // --- Debug: print merged BBO ---
-        if constexpr (debug_mode) {
-          if (!merged.bids.empty() || !merged.asks.empty()) {
-            double mbp=0.0, mbs=0.0, map=0.0, mas=0.0;
-            if (!merged.bids.empty()) { 
-              mbp = merged.bids.begin()->first;
-              mbs = merged.bids.begin()->second;
-            }
-            if (!merged.asks.empty()) { 
-              map = merged.asks.begin()->first;
-              mas = merged.asks.begin()->second;
-            }
-
-            auto _flags = std::cout.flags();
-            auto _prec  = std::cout.precision();
-            std::cout.setf(std::ios::fixed);
-            std::cout << std::setprecision(6);
-            std::cout << "[AGG] merged BBO [bid/ask] " << mbp << "@" 
-              << mbs << " / " << map << "@" << mas << std::endl;
-            std::cout.flags(_flags);
-            std::cout.precision(_prec);
-          }
+        // The interval spaces catch-ups; a delta stream that is behind
+        // catches up in one merged frame when it can (see DeltaStream).
+        const auto now = std::chrono::steady_clock::now();
+        if (caught_up_ && now < last_write_ + min_interval_) {
+          state_ = State::kTimer;
+          alarm_ = std::make_unique<grpc::Alarm>();
+          alarm_->Set(std::chrono::system_clock::now() + (last_write_ + min_interval_ - now),
+                      [this](bool fired) { on_alarm(fired); });
+          return;
         }
-        // --- End debug ---
+        state_ = State::kWriting;
+        const grpc::ByteBuffer* bytes = take(sent_, caught_up_);
+        if (caught_up_) last_write_ = now;
+        const bool print = debug_mode && now - last_print_ >= std::chrono::seconds(1);
+        if (print) last_print_ = now;
+        lk.unlock();
+        if (print) pipeline_.debug_print(view_->current()->msg);
+        StartWrite(bytes);
+        return;
+      }
+    }
 
-        auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-                      std::chrono::system_clock::now().time_since_epoch()).count();
+    const std::chrono::milliseconds min_interval_;
+    std::atomic<std::size_t>& live_;
+    std::mutex mu_;
+    State state_{State::kDone};
+    bool cancelled_{false};
+    bool caught_up_{true};
+    std::uint64_t sent_{0};   // version 0 is the empty placeholder; never sent
+    std::chrono::steady_clock::time_point last_write_{};
+    std::chrono::steady_clock::time_point last_print_{};
+    std::unique_ptr<grpc::Alarm> alarm_;
+  };
 
-        msg.set_ts_ms(static_cast<int64_t>(now_ms));
-        for (auto& [p,s] : merged.bids) { 
-          auto* lv = msg.add_bids(); lv->set_price(p); lv->set_size(s);
-        }
-        for (auto& [p,s] : merged.asks) { 
-          auto* lv = msg.add_asks(); lv->set_price(p); lv->set_size(s);
+  // StreamBook: every write is the whole current version, in the encoding
+  // the subscriber asked for.
+  class BookStream final : public VersionStream {
+  public:
+    BookStream(const Subscription& sub, bookfeed::Encoding encoding, std::atomic<std::size_t>& live)
+      : VersionStream(sub, live), encoding_(encoding) { begin(); }
+
+  private:
+    const grpc::ByteBuffer* take(std::uint64_t& sent, bool& caught_up) override {
+      cur_ = view_->current();   // held until the write completes
+      sent = cur_->msg.version();
+      caught_up = true;
+      return &cur_->wire(encoding_);
+    }
+
+    const bookfeed::Encoding encoding_;
+    std::shared_ptr<const FeedVersion> cur_;
+  };
+
+  // StreamBookDeltas: a snapshot of the current version, then the shared delta
+  // frame of each later version. When more than one version came out since
+  // the last write (the stream's interval held it back, or the client is slow)
+  // they go out as one merged frame, so a delta stream is paced like
+  // StreamBook. A stream that has fallen behind the pipeline's delta log gets
+  // a fresh snapshot instead.
+  class DeltaStream final : public VersionStream {
+  public:
+    DeltaStream(const Subscription& sub, std::atomic<std::size_t>& live)
+      : VersionStream(sub, live) { begin(); }
+
+  private:
+    const grpc::ByteBuffer* take(std::uint64_t& sent, bool& caught_up) override {
+      if (sent != 0) {
+        const std::uint64_t latest = view_->current()->msg.version();
+        if (latest > sent + 1) {
+          frame_.reset();
+          if (!own_) own_ = std::make_unique<grpc::ByteBuffer>();
+          if (view_->merge_deltas(sent, latest, *own_)) {
+            sent = latest;
+            caught_up = true;
+            return own_.get();
+          }
+        } else if (auto frame = view_->deltas().at(sent + 1)) {
+          own_.reset();                // a snapshot or merged write has completed
+          frame_ = std::move(frame);   // held until the write completes
+          ++sent;
+          caught_up = true;
+          return &frame_->bytes;
         }
       }
-      if (!writer->Write(msg)) break;
-      std::this_thread::sleep_for(std::chrono::milliseconds(200));
+      // Snapshots are rare (subscribe, fell out of the log), so their
+      // storage lives only until the next shared frame instead of for the
+      // stream; so does a merged frame's.
+      frame_.reset();
+      const auto cur = view_->current();
+      const auto& msg = cur->msg;
+      bookfeed::BookDelta snap;
+      snap.set_seq(msg.version());
+      snap.set_snapshot(true);
+      snap.set_ts_ms(msg.ts_ms());
+      snap.mutable_bids()->CopyFrom(msg.bids());
+      snap.mutable_asks()->CopyFrom(msg.asks());
+      own_ = std::make_unique<grpc::ByteBuffer>();
+      bool own = false;
+      grpc::SerializationTraits<bookfeed::BookDelta>::Serialize(snap, own_.get(), &own);
+      sent = msg.version();
+      caught_up = true;
+      return own_.get();
     }
-    return grpc::Status::OK;
-  }
 
-private:
-  std::unique_ptr<BinanceAdapter> binance_;
-  std::unique_ptr<OKXAdapter> okx_;
-  std::unique_ptr<KrakenAdapter> kraken_;
-
-  std::mutex mu_;
-  OrderBook book_binance_, book_okx_, book_kraken_;
-  ConsolidationCfg cfg_{0.1, 200};
-
-  void onVenueUpdate(const OrderBook& b, const char* venue) {
-    std::lock_guard<std::mutex> lk(mu_);
-    if (std::string(venue)=="BINANCE") book_binance_ = b;
-    else if (std::string(venue)=="OKX") book_okx_ = b;
-    else if (std::string(venue)=="KRAKEN") book_kraken_ = b;
-  }
+    std::shared_ptr<const DeltaFrame> frame_;
+    std::unique_ptr<grpc::ByteBuffer> own_;   // this stream's snapshot or merged frame
+  };
 };
 
 
 int main() {
   const std::string addr = "0.0.0.0:50051";
-  BookFeedService svc;
+  const char* upstream = std::getenv("AGG_UPSTREAM");
+  auto symbols = upstream ? relay_table(upstream) : symbol_table();
+  const std::size_t shards = shard_count(symbols.size());
+  const auto interval = min_interval();
+  const std::size_t streams = max_streams();
+  BookFeedService svc(std::move(symbols), shards, interval, streams, shm_prefix());
   grpc::ServerBuilder builder;
   builder.AddListeningPort(addr, grpc::InsecureServerCredentials());
   builder.RegisterService(&svc);
+  // Relays keep a quiet stream alive with keepalive pings; accept them.
+  builder.AddChannelArgument(GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS, 1000);
+  builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
   auto server = builder.BuildAndStart();
-  std::cout << "Aggregator listening on " << addr << std::endl;
+  if (upstream) std::cout << "Relaying " << upstream << std::endl;
+  std::cout << "Aggregator listening on " << addr << " (" << shards << " shards, min interval "
+            << interval.count() << " ms, max " << streams << " streams)" << std::endl;
   server->Wait();
   return 0;
 }
@@ -1,4 +1,7 @@
 #include "okx_adapter.h"
+#include "book_checksum.h"
+#include "json_cursor.h"
+#include "ws_conflation.h"
 #include <boost/asio.hpp>
 #include <boost/beast/core.hpp>
 #include <boost/beast/ssl.hpp>
@@ -15,7 +18,8 @@ namespace http = boost::beast::http;
 using json = nlohmann::json;
 
 
-OKXAdapter::OKXAdapter(std::string symbol) : AdapterBase(std::move(symbol)){}
+OKXAdapter::OKXAdapter(std::string symbol, FixedScale scale, double price_tick)
+  : AdapterBase(std::move(symbol), scale, price_tick){}
 OKXAdapter::~OKXAdapter(){ stop(); }
 
 
@@ -79,19 +83,18 @@ bool OKXAdapter::fetch_snapshot(OrderBook& out_book, std::string& err) {
       return false;
     }
 
-    out_book.bids.clear();
-    out_book.asks.clear();
+    reset_book(out_book);
 
     for (auto& lvl : j["data"][0]["bids"]) {
-      double p = std::stod(lvl[0].get<std::string>());
-      double s = std::stod(lvl[1].get<std::string>());
-      if (s > 0) out_book.bids[p] = s;
+      px_t p = out_book.scale.parse_px(lvl[0].get_ref<const std::string&>());
+      qty_t s = out_book.scale.parse_qty(lvl[1].get_ref<const std::string&>());
+      if (s > 0) set_level(out_book, BookEvent::Kind::kBid, p, s);
     }
 
     for (auto& lvl : j["data"][0]["asks"]) {
-      double p = std::stod(lvl[0].get<std::string>());
-      double s = std::stod(lvl[1].get<std::string>());
-      if (s > 0) out_book.asks[p] = s;
+      px_t p = out_book.scale.parse_px(lvl[0].get_ref<const std::string&>());
+      qty_t s = out_book.scale.parse_qty(lvl[1].get_ref<const std::string&>());
+      if (s > 0) set_level(out_book, BookEvent::Kind::kAsk, p, s);
     }
 
     return true;
@@ -101,89 +104,103 @@ bool OKXAdapter::fetch_snapshot(OrderBook& out_book, std::string& err) {
   }
 }
 
-void OKXAdapter::apply_update_json(const std::string& payload, OrderBook& book) {
-  auto j = json::parse(payload);
-
-  std::vector<json> messages;
-  if (j.is_array()) {
-    for (auto& el : j) messages.push_back(el);
-  } else if (j.is_object()) {
-    messages.push_back(j);
-  } else {
-    return;
+void OKXAdapter::apply_update_json(std::string_view payload, OrderBook& book) {
+  JsonCursor c(payload);
+  // A frame carries one message object or an array of them.
+  switch (c.type()) {
+    case JsonCursor::Type::kObject: apply_message(c, book); break;
+    case JsonCursor::Type::kArray:
+      c.elements([&] { if (c.type() == JsonCursor::Type::kObject) apply_message(c, book); });
+      break;
+    default: break;
   }
+}
 
-  for (auto& msg : messages) {
-    if (msg.contains("event")) continue;
-
-    if (!msg.contains("data") || !msg["data"].is_array() || msg["data"].empty()) continue;
-    const auto& entry = msg["data"].front();
-
-    if (msg.contains("arg") && msg["arg"].contains("channel")
-        && msg["arg"]["channel"].is_string()
-        && msg["arg"]["channel"] != "books") continue;
-
-    long long seq = entry.contains("seqId") && entry["seqId"].is_number_integer()
-                    ? entry["seqId"].get<long long>() : -1;
-    long long prev = entry.contains("prevSeqId") && entry["prevSeqId"].is_number_integer()
-                     ? entry["prevSeqId"].get<long long>() : -2;
-
-    bool is_snapshot = (msg.contains("action")
-                        && msg["action"].is_string()
-                        && msg["action"] == "snapshot");
-    if (!is_snapshot && prev == -1) is_snapshot = true;
-
-    if (is_snapshot) {
-      book.bids.clear();
-      book.asks.clear();
-
-      auto fill_side = [&](const json& arr, auto& side) {
-        if (!arr.is_array()) return;
-        for (const auto& lvl : arr) {
-          if (!lvl.is_array() || lvl.size() < 2) continue;
-          double p = lvl[0].is_string() ? std::stod(lvl[0].get<std::string>()) : lvl[0].get<double>();
-          double s = lvl[1].is_string() ? std::stod(lvl[1].get<std::string>()) : lvl[1].get<double>();
-          if (s > 0) side[p] = s;
-        }
-      };
-
-      if (entry.contains("bids")) fill_side(entry["bids"], book.bids);
-      if (entry.contains("asks")) fill_side(entry["asks"], book.asks);
-      if (entry.contains("b"))    fill_side(entry["b"],    book.bids);
-      if (entry.contains("a"))    fill_side(entry["a"],    book.asks);
+// Drop the book and its sequence state; run() resubscribes the channel.
+void OKXAdapter::resync(OrderBook& book, const char* why) {
+  std::cerr << "[OKX][WS] " << symbol_ << ": " << why << ", resubscribing" << std::endl;
+  invalidate_book(book);
+  got_ws_snapshot = false;
+  last_seq_id = -1;
+}
 
-      got_ws_snapshot = true;
-      if (seq >= 0) last_seq_id = seq;
-      continue;
+// One message, read in a single pass: its first data entry's levels are
+// collected while scanning, and applied once the whole message (action,
+// channel, sequence ids) has been seen. The resulting book is then checked
+// against the message's checksum.
+void OKXAdapter::apply_message(JsonCursor& c, OrderBook& book) {
+  std::pmr::memory_resource* mr = scratch();
+  std::pmr::vector<Delta> bid_d{mr}, ask_d{mr};
+  bool event = false, other_channel = false, snapshot_action = false, has_entry = false;
+  long long seq = -1, prev = -2, checksum = 0;
+  bool has_checksum = false;
+
+  auto collect = [&](std::pmr::vector<Delta>& out) {
+    if (c.type() != JsonCursor::Type::kArray) return;
+    c.elements([&] {
+      if (c.type() != JsonCursor::Type::kArray) return;
+      px_t p = 0;
+      int n = 0;
+      c.elements([&] {
+        if (n == 0) p = book.scale.parse_px(c.scalar());
+        else if (n == 1) out.emplace_back(p, book.scale.parse_qty(c.scalar()));
+        ++n;
+      });
+    });
+  };
+  auto read_entry = [&] {
+    c.fields([&](std::string_view key) {
+      if (key == "bids" || key == "b") collect(bid_d);
+      else if (key == "asks" || key == "a") collect(ask_d);
+      else if (key == "seqId" && c.type() == JsonCursor::Type::kNumber) seq = c.integer();
+      else if (key == "prevSeqId" && c.type() == JsonCursor::Type::kNumber) prev = c.integer();
+      else if (key == "checksum" && c.type() == JsonCursor::Type::kNumber) {
+        checksum = c.integer();
+        has_checksum = true;
+      }
+    });
+  };
+
+  c.fields([&](std::string_view key) {
+    if (key == "event") {
+      event = true;
+    } else if (key == "action") {
+      snapshot_action = c.type() == JsonCursor::Type::kString && c.string() == "snapshot";
+    } else if (key == "arg" && c.type() == JsonCursor::Type::kObject) {
+      c.fields([&](std::string_view k) {
+        if (k == "channel" && c.type() == JsonCursor::Type::kString) other_channel = c.string() != "books";
+      });
+    } else if (key == "data" && c.type() == JsonCursor::Type::kArray) {
+      bool first = true;
+      c.elements([&] {
+        if (!first) return;
+        first = false;
+        has_entry = true;
+        if (c.type() == JsonCursor::Type::kObject) read_entry();
+      });
     }
-
-    if (!got_ws_snapshot) continue;
-
+  });
+  if (event || !has_entry || other_channel) return;
+
+  const bool is_snapshot = snapshot_action || prev == -1;
+  if (is_snapshot) {
+    reset_book(book);
+    for (const auto& [p, s] : bid_d) if (s > 0) set_level(book, BookEvent::Kind::kBid, p, s);
+    for (const auto& [p, s] : ask_d) if (s > 0) set_level(book, BookEvent::Kind::kAsk, p, s);
+    got_ws_snapshot = true;
+  } else {
+    if (!got_ws_snapshot) return;
     if (prev != -2 && last_seq_id != -1 && prev != last_seq_id) {
-      throw std::runtime_error("OKX seq mismatch: prevSeqId != last_seq_id");
+      resync(book, "seq mismatch (prevSeqId != last seqId)");
+      return;
     }
-
-    std::vector<std::pair<double,double>> bid_d, ask_d;
-    auto collect_side = [&](const json& arr, std::vector<std::pair<double,double>>& out) {
-      if (!arr.is_array()) return;
-      for (const auto& lvl : arr) {
-        if (!lvl.is_array() || lvl.size() < 2) continue;
-        double p = lvl[0].is_string() ? std::stod(lvl[0].get<std::string>()) : lvl[0].get<double>();
-        double s = lvl[1].is_string() ? std::stod(lvl[1].get<std::string>()) : lvl[1].get<double>();
-        out.emplace_back(p, s);
-      }
-    };
-
-    if (entry.contains("bids")) collect_side(entry["bids"], bid_d);
-    if (entry.contains("asks")) collect_side(entry["asks"], ask_d);
-    if (entry.contains("b"))    collect_side(entry["b"],    bid_d);
-    if (entry.contains("a"))    collect_side(entry["a"],    ask_d);
-
-    if (!bid_d.empty()) apply_deltas(book.bids, bid_d);
-    if (!ask_d.empty()) apply_deltas(book.asks, ask_d);
-
-    if (seq >= 0) last_seq_id = seq;
+    if (!bid_d.empty()) apply_levels(book, BookEvent::Kind::kBid, bid_d);
+    if (!ask_d.empty()) apply_levels(book, BookEvent::Kind::kAsk, ask_d);
   }
+  if (seq >= 0) last_seq_id = seq;
+
+  if (has_checksum && okx_checksum(book) != static_cast<std::int32_t>(checksum))
+    resync(book, "checksum mismatch");
 }
 
 void OKXAdapter::run(Callback cb) {
@@ -232,23 +249,32 @@ void OKXAdapter::run(Callback cb) {
 
       ws.handshake(host, path);
 
-      json sub;
-      sub["op"] = "subscribe";
-      sub["args"] = json::array({ { {"channel","books"}, {"instId", symbol_} } });
-      ws.write(boost::asio::buffer(sub.dump()));
+      auto request = [&](const char* op) {
+        json m;
+        m["op"] = op;
+        m["args"] = json::array({ { {"channel","books"}, {"instId", symbol_} } });
+        return m.dump();
+      };
+      const std::string sub_msg = request("subscribe");
+      const std::string unsub_msg = request("unsubscribe");
+      ws.write(boost::asio::buffer(sub_msg));
 
-      OrderBook book;
+      OrderBook book{scale_, tick_, &book_pool_};
       boost::beast::flat_buffer buffer;
+      buffer.reserve(kWsFrameReserve);
 
       while (running()) {
-        buffer.clear();
-        ws.read(buffer);
-        std::string payload = boost::beast::buffers_to_string(buffer.data());
-
         try {
-          apply_update_json(payload, book);
-          if (got_ws_snapshot) {
-            cb(book, "OKX");
+          count_burst(ws_read_burst(ws, buffer, conflation_, [&](std::string_view frame) {
+            apply_update_json(frame, book);
+          }));
+          if (take_resubscribe()) {
+            // Only the channel is redone; the connection stays up.
+            ws.write(boost::asio::buffer(unsub_msg));
+            ws.write(boost::asio::buffer(sub_msg));
+            publish(cb, book);
+          } else if (got_ws_snapshot) {
+            publish(cb, book);
           }
         } catch (const std::exception& e) {
           std::cerr << "[OKX][WS] apply error: " << e.what() << " — resubscribing..." << std::endl;
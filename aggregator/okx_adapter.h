@@ -4,23 +4,31 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <string_view>
 #include "../common/order_book.h"
 #include "adapter_base.h"
 
+class JsonCursor;
+
 class OKXAdapter : public AdapterBase {
 public:
   using Callback = AdapterBase::Callback;
 
-  explicit OKXAdapter(std::string symbol = "BTC-USDT");
+  explicit OKXAdapter(std::string symbol = "BTC-USDT", FixedScale scale = {},
+                      double price_tick = 0.1);
   ~OKXAdapter();
 
+  const char* name() const override { return "OKX"; }
+
   using AdapterBase::start;
   using AdapterBase::stop;
 
 private:
   void run(Callback cb) override;
   bool fetch_snapshot(OrderBook& out_book, std::string& err);
-  void apply_update_json(const std::string& payload, OrderBook& book);
+  void apply_update_json(std::string_view payload, OrderBook& book);
+  void apply_message(JsonCursor& c, OrderBook& book);
+  void resync(OrderBook& book, const char* why);
   bool got_ws_snapshot{false};
   long long last_seq_id{-1};
 };
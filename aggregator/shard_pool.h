@@ -0,0 +1,80 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// A fixed set of shard threads, each running the pollers assigned to it.
+//
+// A poller belongs to exactly one shard and is only ever called from that
+// shard's thread, so whatever state sits behind it (a symbol's venue replicas
+// and consolidator) needs no locking. Pollers are spread round-robin at add()
+// time; a shard sleeps briefly when none of its pollers found work.
+class ShardPool {
+public:
+  // Returns true if it did any work.
+  using Poller = std::function<bool()>;
+
+  // pin: bind shard i to CPU i (best effort).
+  explicit ShardPool(std::size_t shards, bool pin = false)
+    : shards_(shards ? shards : 1), pin_(pin) {}
+  ~ShardPool() { stop(); }
+
+  ShardPool(const ShardPool&) = delete;
+  ShardPool& operator=(const ShardPool&) = delete;
+
+  std::size_t size() const { return shards_.size(); }
+
+  // Before start(). Returns the shard that will run p.
+  std::size_t add(Poller p) {
+    const std::size_t s = next_++ % shards_.size();
+    shards_[s].pollers.push_back(std::move(p));
+    return s;
+  }
+
+  void start() {
+    bool expected = false;
+    if (!running_.compare_exchange_strong(expected, true)) return;
+    for (std::size_t i = 0; i < shards_.size(); ++i) {
+      shards_[i].th = std::thread([this, i] { run(i); });
+      if (pin_) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(i % std::thread::hardware_concurrency(), &set);
+        pthread_setaffinity_np(shards_[i].th.native_handle(), sizeof(set), &set);
+      }
+    }
+  }
+
+  void stop() {
+    bool expected = true;
+    if (!running_.compare_exchange_strong(expected, false)) return;
+    for (auto& s : shards_) if (s.th.joinable()) s.th.join();
+  }
+
+private:
+  struct Shard {
+    std::vector<Poller> pollers;
+    std::thread th;
+  };
+
+  void run(std::size_t i) {
+    auto& pollers = shards_[i].pollers;
+    while (running_.load(std::memory_order_relaxed)) {
+      bool busy = false;
+      for (auto& p : pollers) busy |= p();
+      if (!busy) std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  }
+
+  std::vector<Shard> shards_;
+  bool pin_;
+  std::size_t next_{0};
+  std::atomic<bool> running_{false};
+};
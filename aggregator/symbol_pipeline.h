@@ -0,0 +1,273 @@
+#pragma once
+
+#include "bookfeed.pb.h"
+
+#include "../common/book_event.h"
+#include "../common/consolidator.h"
+#include "../common/order_book.h"
+#include "../common/published.h"
+#include "../common/shm_book.h"
+#include "book_view.h"
+#include "venues.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// One instrument as the aggregator serves it: the name subscribers ask for,
+// the venues that list it (venue ids follow this order), and the
+// consolidation settings.
+struct SymbolSpec {
+  std::string symbol;              // SubscribeRequest.symbol
+  std::vector<VenueSpec> venues;
+  FixedScale scale{};
+  ConsolidationCfg cfg{0.1, 200};
+};
+
+// Everything behind one symbol: its venue table (adapters, the delta rings
+// they feed, our replicas of their books), and one BookView per distinct
+// consolidation its subscribers asked for. Views at the same tick share one
+// bucket engine, fed once per event; each view only cuts it to its own depth.
+// A view lives while it has subscribers (the default view always does).
+// poll() is run by the one shard thread that owns the symbol; subscribe()
+// and release() may be called from any thread.
+class SymbolPipeline {
+public:
+  // Per symbol: deepest consolidation served, and distinct views subscribed
+  // at once.
+  static constexpr std::size_t kMaxDepth = 1000;
+  static constexpr std::size_t kMaxViews = 16;
+  static_assert(UpstreamAdapter::kDepth <= kMaxDepth);
+
+  SymbolPipeline(SymbolSpec spec, AdapterBase::Conflation conflation)
+    : spec_(std::move(spec)),
+      bbos_(spec_.venues.size()) {
+    const std::size_t n = spec_.venues.size();
+    adapters_.reserve(n);
+    rings_.reserve(n);
+    replicas_.reserve(n);
+    for (const VenueSpec& v : spec_.venues) add_venue(make_adapter(v, spec_.scale), conflation);
+    check_servable(spec_.scale.tick_to_px(spec_.cfg.tick), spec_.cfg.topN);
+    default_ = std::make_shared<BookView>(spec_.scale, spec_.cfg);
+    views_.push_back(default_);
+    views_gen_.store(1, std::memory_order_release);
+  }
+  ~SymbolPipeline() { stop(); }
+
+  const SymbolSpec& spec() const { return spec_; }
+  std::size_t venues() const { return adapters_.size(); }
+
+  void start() {
+    for (std::size_t v = 0; v < adapters_.size(); ++v) adapters_[v]->start(rings_[v].get());
+  }
+  void stop() {
+    for (auto& a : adapters_) a->stop();
+  }
+
+  // Owning shard thread only: apply the adapters' deltas to the replicas and
+  // every tick's engine, and let each view publish a new version if its topN
+  // changed, however many messages this pass drained.
+  bool poll() {
+    if (views_gen_.load(std::memory_order_acquire) != seen_gen_) sync_views();
+    bool busy = false;
+    for (std::size_t v = 0; v < adapters_.size(); ++v) busy |= drain(static_cast<VenueId>(v));
+    for (auto& g : groups_) {
+      for (const auto& view : g->views) {
+        if (view->publish(g->engine) && shm_ && view == default_)
+          shm_->write(view->version(), view->current()->msg.ts_ms(), view->book());
+      }
+      g->engine.clear_changes();
+    }
+    return busy;
+  }
+
+  // Before start(): also write every version of the default view into the
+  // shared-memory segment `name` (see shm_book.h) for readers on this host.
+  // The segment counts as a subscriber, so the view always publishes.
+  void publish_shm(const std::string& name) {
+    shm_ = std::make_unique<ShmBookWriter>(name, spec_.symbol, spec_.scale,
+                                           static_cast<std::uint32_t>(spec_.cfg.topN));
+    std::lock_guard<std::mutex> lk(views_mu_);
+    default_->subscribe();
+  }
+
+  // The symbol's own consolidation (spec().cfg).
+  BookView& default_view() { return *default_; }
+
+  // Count one more subscriber of the view consolidating at cfg, created on
+  // first use; a tick or topN of 0 takes the symbol's default. Throws
+  // std::invalid_argument for an invalid cfg, one deeper than kMaxDepth, or
+  // one a depth-limited venue cannot fill (see check_servable());
+  // returns null if kMaxViews views are already subscribed. Pair with
+  // release().
+  std::shared_ptr<BookView> subscribe(ConsolidationCfg cfg) {
+    if (cfg.tick == 0.0) cfg.tick = spec_.cfg.tick;
+    if (cfg.topN == 0) cfg.topN = spec_.cfg.topN;
+    detail::check_cfg(cfg);
+    if (cfg.topN > kMaxDepth) throw std::invalid_argument("depth above the server's limit");
+    const px_t tick = spec_.scale.tick_to_px(cfg.tick);
+    if (tick <= 0) throw std::invalid_argument("tick below the price resolution");
+    check_servable(tick, cfg.topN);
+
+    std::lock_guard<std::mutex> lk(views_mu_);
+    for (auto& v : views_) {
+      if (v->tick() == tick && v->cfg().topN == cfg.topN) {
+        v->subscribe();
+        return v;
+      }
+    }
+    if (views_.size() >= kMaxViews) return nullptr;
+    auto v = std::make_shared<BookView>(spec_.scale, cfg);
+    v->subscribe();
+    views_.push_back(v);
+    views_gen_.fetch_add(1, std::memory_order_release);
+    return v;
+  }
+
+  // One subscriber of view is gone; the last one frees the view (its slot at
+  // once, its memory once the shard thread and every stream let go).
+  void release(BookView& view) {
+    std::lock_guard<std::mutex> lk(views_mu_);
+    if (view.unsubscribe() != 0 || &view == default_.get()) return;
+    std::erase_if(views_, [&](const auto& v) { return v.get() == &view; });
+    views_gen_.fetch_add(1, std::memory_order_release);
+  }
+
+  // Distinct views subscribed, and tick engines fed (shard thread).
+  std::size_t view_count() {
+    std::lock_guard<std::mutex> lk(views_mu_);
+    return views_.size();
+  }
+  std::size_t engine_count() const { return groups_.size(); }
+
+  // Per-venue BBOs (with the frames each venue conflated so far), source
+  // count and the merged BBO of msg.
+  void debug_print(const bookfeed::ConsolidatedBook& msg) const {
+    const FixedScale& sc = spec_.scale;
+    auto _flags = std::cout.flags();
+    auto _prec  = std::cout.precision();
+    std::cout.setf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+
+    int sources = 0;
+    std::cout << "[AGG " << spec_.symbol << "] src BBOs [bid/ask]";
+    for (std::size_t v = 0; v < adapters_.size(); ++v) {
+      const auto q = bbos_[v].load();
+      if (q->has_bid || q->has_ask) ++sources;
+      std::cout << "  " << adapters_[v]->name() << " "
+                << (q->has_bid ? sc.px_to_double(q->bid_px) : 0.0) << "@"
+                << (q->has_bid ? sc.qty_to_double(q->bid_sz) : 0.0) << "/"
+                << (q->has_ask ? sc.px_to_double(q->ask_px) : 0.0) << "@"
+                << (q->has_ask ? sc.qty_to_double(q->ask_sz) : 0.0);
+      if (const auto c = adapters_[v]->coalesced_frames()) std::cout << " (" << c << " coalesced)";
+    }
+    std::cout << "  (sources=" << sources << "/" << adapters_.size() << ")" << std::endl;
+
+    if (msg.bids_size() > 0 || msg.asks_size() > 0) {
+      double mbp=0.0, mbs=0.0, map=0.0, mas=0.0;
+      if (msg.bids_size() > 0) { mbp = msg.bids(0).price(); mbs = msg.bids(0).size(); }
+      if (msg.asks_size() > 0) { map = msg.asks(0).price(); mas = msg.asks(0).size(); }
+      std::cout << "[AGG " << spec_.symbol << "] merged BBO [bid/ask] " << mbp << "@"
+        << mbs << " / " << map << "@" << mas << "  (v" << msg.version() << ")" << std::endl;
+    }
+    std::cout.flags(_flags);
+    std::cout.precision(_prec);
+  }
+
+private:
+  // Registers an adapter under the next venue id; its ring, replica and BBO
+  // take the same slot.
+  void add_venue(std::unique_ptr<AdapterBase> a, AdapterBase::Conflation conflation) {
+    const auto id = static_cast<VenueId>(adapters_.size());
+    a->set_venue_id(id);
+    a->set_conflation(conflation);
+    rings_.push_back(std::make_unique<AdapterBase::DeltaRing>(1 << 15));
+    replicas_.emplace_back(OrderBook{spec_.scale, a->price_tick()});
+    adapters_.push_back(std::move(a));
+  }
+
+  // A venue that only has the top depth_limit() levels at its own tick (an
+  // upstream aggregator's consolidated book) can fill a consolidation only at
+  // a multiple of that tick, whose buckets each take whole venue buckets, and
+  // only as deep as those levels reach: topN * (tick / venue tick) of them.
+  void check_servable(px_t tick, std::size_t top_n) const {
+    for (const auto& a : adapters_) {
+      const std::size_t limit = a->depth_limit();
+      if (limit == 0) continue;
+      if (tick % a->price_tick() != 0)
+        throw std::invalid_argument("tick is not a multiple of the upstream tick");
+      if (static_cast<std::size_t>(tick / a->price_tick()) > limit / top_n)
+        throw std::invalid_argument("depth beyond the upstream book at this tick");
+    }
+  }
+
+  // Views at one tick and the engine they share.
+  struct TickGroup {
+    TickGroup(FixedScale scale, const ConsolidationCfg& cfg, std::size_t venues)
+      : engine(scale, cfg, venues) {}
+    IncrementalConsolidator engine;
+    std::vector<std::shared_ptr<BookView>> views;
+  };
+
+  // Shard thread: bring groups_ in line with the subscribed views. Freed
+  // views are dropped, with their engine once no view uses it; a new tick
+  // gets an engine loaded from the replicas' current books.
+  void sync_views() {
+    std::lock_guard<std::mutex> lk(views_mu_);
+    for (auto& g : groups_) {
+      std::erase_if(g->views, [&](const auto& view) {
+        return std::find(views_.begin(), views_.end(), view) == views_.end();
+      });
+    }
+    std::erase_if(groups_, [](const auto& g) { return g->views.empty(); });
+
+    for (const auto& view : views_) {
+      auto g = std::find_if(groups_.begin(), groups_.end(),
+                            [&](const auto& grp) { return grp->engine.tick() == view->tick(); });
+      if (g == groups_.end()) {
+        groups_.push_back(std::make_unique<TickGroup>(spec_.scale, view->cfg(), replicas_.size()));
+        g = std::prev(groups_.end());
+        for (std::size_t v = 0; v < replicas_.size(); ++v)
+          (*g)->engine.load(static_cast<VenueId>(v), replicas_[v].book());
+      }
+      auto& vs = (*g)->views;
+      if (std::find(vs.begin(), vs.end(), view) == vs.end()) vs.push_back(view);
+    }
+    seen_gen_ = views_gen_.load(std::memory_order_relaxed);
+  }
+
+  bool drain(VenueId v) {
+    BookReplica& replica = replicas_[v];
+    bool committed = false;
+    const std::size_t n = rings_[v]->drain([&](const BookEvent& e) {
+      committed |= replica.apply(e);
+      for (auto& g : groups_) g->engine.apply(v, e);
+    });
+    if (committed) bbos_[v].publish(replica.book().bbo());
+    return n > 0;
+  }
+
+  SymbolSpec spec_;
+
+  // The venue table: slot v of each array belongs to the adapter with venue id v.
+  std::vector<std::unique_ptr<AdapterBase>> adapters_;
+  std::vector<std::unique_ptr<AdapterBase::DeltaRing>> rings_;   // ring addresses stay fixed
+  std::vector<BookReplica> replicas_;                             // owning shard thread only
+  std::vector<Published<Bbo>> bbos_;                              // debug output only
+
+  std::mutex views_mu_;
+  std::shared_ptr<BookView> default_;
+  std::vector<std::shared_ptr<BookView>> views_;     // subscribed views, under views_mu_
+  std::atomic<std::uint64_t> views_gen_{0};          // bumped when views_ changes
+  std::uint64_t seen_gen_{0};                        // shard thread only
+  std::vector<std::unique_ptr<TickGroup>> groups_;   // shard thread only
+  std::unique_ptr<ShmBookWriter> shm_;             // written by the shard thread
+};
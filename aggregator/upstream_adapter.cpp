@@ -0,0 +1,117 @@
+#include "upstream_adapter.h"
+#include "bookfeed.grpc.pb.h"
+#include "../common/packed_book.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+
+UpstreamAdapter::UpstreamAdapter(std::string endpoint, std::string symbol, FixedScale scale,
+                                 double price_tick, std::chrono::milliseconds keepalive)
+  : AdapterBase(std::move(symbol), scale, price_tick),
+    endpoint_(std::move(endpoint)), keepalive_(keepalive), next_(scale_, tick_) {}
+UpstreamAdapter::~UpstreamAdapter(){ stop(); }
+
+
+void UpstreamAdapter::interrupt() {
+  std::lock_guard<std::mutex> lk(call_mu_);
+  if (call_) call_->TryCancel();
+}
+
+// Sleep d, but return early once stop() was called.
+void UpstreamAdapter::nap(std::chrono::milliseconds d) const {
+  const auto until = std::chrono::steady_clock::now() + d;
+  while (running() && std::chrono::steady_clock::now() < until)
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+}
+
+// Bring book to the levels of msg, pushing only the levels that differ.
+// Returns false if msg cannot be applied (not PACKED, or another scale).
+bool UpstreamAdapter::apply_version(const bookfeed::ConsolidatedBook& msg, OrderBook& book) {
+  if (!unpack_levels(msg, flat_)) return false;
+  if (flat_.scale.px_dp != scale_.px_dp || flat_.scale.qty_dp != scale_.qty_dp) return false;
+
+  next_.bids.clear();
+  next_.asks.clear();
+  for (const auto& [p, s] : flat_.bids) next_.bids.set(p, s);
+  for (const auto& [p, s] : flat_.asks) next_.asks.set(p, s);
+
+  bid_d_.clear();
+  ask_d_.clear();
+  diff_levels(book.bids, next_.bids, [&](px_t p, qty_t q) { bid_d_.push_back({p, q}); });
+  diff_levels(book.asks, next_.asks, [&](px_t p, qty_t q) { ask_d_.push_back({p, q}); });
+  apply_levels(book, BookEvent::Kind::kBid, bid_d_);
+  apply_levels(book, BookEvent::Kind::kAsk, ask_d_);
+  return true;
+}
+
+void UpstreamAdapter::run(Callback cb) {
+  using namespace std::chrono_literals;
+
+  // Keepalive pings notice an upstream that stopped answering even while the
+  // book is quiet; reconnect attempts back off only briefly, since a relay
+  // without its upstream serves nothing.
+  grpc::ChannelArguments args;
+  args.SetInt(GRPC_ARG_KEEPALIVE_TIME_MS, static_cast<int>(keepalive_.count()));
+  args.SetInt(GRPC_ARG_KEEPALIVE_TIMEOUT_MS, static_cast<int>(keepalive_.count()));
+  args.SetInt(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+  args.SetInt(GRPC_ARG_HTTP2_MAX_PINGS_WITHOUT_DATA, 0);
+  args.SetInt(GRPC_ARG_INITIAL_RECONNECT_BACKOFF_MS, 100);
+  args.SetInt(GRPC_ARG_MIN_RECONNECT_BACKOFF_MS, 100);
+  args.SetInt(GRPC_ARG_MAX_RECONNECT_BACKOFF_MS, 1000);
+  auto channel = grpc::CreateCustomChannel(endpoint_, grpc::InsecureChannelCredentials(), args);
+  auto stub = bookfeed::BookFeed::NewStub(channel);
+
+  bookfeed::SubscribeRequest req;
+  req.set_symbol(symbol_);
+  req.set_encoding(bookfeed::PACKED);
+  req.set_tick(scale_.px_to_double(tick_));
+  req.set_depth(static_cast<std::uint32_t>(kDepth));
+
+  OrderBook book{scale_, tick_, &book_pool_};
+  auto backoff = 100ms;
+
+  while (running()) {
+    grpc::ClientContext ctx;
+    {
+      std::lock_guard<std::mutex> lk(call_mu_);
+      if (!running()) break;
+      call_ = &ctx;
+    }
+    connects_.fetch_add(1, std::memory_order_relaxed);
+    auto reader = stub->StreamBook(&ctx, req);
+
+    bookfeed::ConsolidatedBook msg;
+    bool live = false;
+    while (reader->Read(&msg)) {
+      if (!apply_version(msg, book)) {
+        std::cerr << "[UPSTREAM] " << endpoint_ << " " << symbol_
+                  << ": version not PACKED at this scale, reconnecting" << std::endl;
+        ctx.TryCancel();
+        break;
+      }
+      live = true;
+      backoff = 100ms;
+      versions_.fetch_add(1, std::memory_order_relaxed);
+      publish(cb, book);
+    }
+    const grpc::Status st = reader->Finish();
+    {
+      std::lock_guard<std::mutex> lk(call_mu_);
+      call_ = nullptr;
+    }
+
+    // Without a live upstream the book is stale: serve it empty until the
+    // next stream delivers a version.
+    if (!book.bids.empty() || !book.asks.empty()) {
+      reset_book(book);
+      publish(cb, book);
+    }
+    if (!running()) break;
+    if (live || st.error_code() != grpc::StatusCode::UNAVAILABLE)
+      std::cerr << "[UPSTREAM] " << endpoint_ << " " << symbol_ << " stream ended: "
+                << (st.ok() ? "ok" : st.error_message()) << ", reconnecting" << std::endl;
+    nap(backoff);
+    backoff = std::min(backoff * 2, std::chrono::milliseconds(1000));
+  }
+}
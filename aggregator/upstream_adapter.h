@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <grpcpp/grpcpp.h>
+#include "bookfeed.pb.h"
+#include "../common/consolidator.h"
+#include "../common/order_book.h"
+#include "adapter_base.h"
+
+// A venue that is another aggregator: follows its StreamBook for one symbol
+// and hands each consolidated version on as this adapter's book, so an
+// aggregator can run as a relay in front of a feed-handling core (AGG_UPSTREAM
+// in main.cpp). Versions arrive PACKED, so levels stay exact fixed-point
+// ticks; only the levels that changed between two versions are pushed.
+//
+// The book is only served while the upstream stream is live. When the stream
+// ends, fails, or the connection stops answering keepalive pings within
+// `keepalive`, the book is cleared (consumers see an empty book rather than a
+// stale one) and the adapter reconnects; the upstream's first version on the
+// new stream rebuilds it.
+class UpstreamAdapter : public AdapterBase {
+public:
+  using Callback = AdapterBase::Callback;
+
+  // Levels per side asked of the upstream: the deepest book an aggregator
+  // serves (SymbolPipeline::kMaxDepth).
+  static constexpr std::size_t kDepth = 1000;
+
+  // endpoint: "host:port" of the upstream aggregator. price_tick is the
+  // upstream consolidation tick asked for (and this venue's increment).
+  UpstreamAdapter(std::string endpoint, std::string symbol, FixedScale scale, double price_tick,
+                  std::chrono::milliseconds keepalive = std::chrono::seconds(10));
+  ~UpstreamAdapter();
+
+  const char* name() const override { return "UPSTREAM"; }
+  std::size_t depth_limit() const override { return kDepth; }
+
+  // Upstream versions received, and streams opened, so far.
+  std::uint64_t versions() const { return versions_.load(std::memory_order_relaxed); }
+  std::uint64_t connects() const { return connects_.load(std::memory_order_relaxed); }
+
+  using AdapterBase::start;
+  using AdapterBase::stop;
+
+private:
+  void run(Callback cb) override;
+  void interrupt() override;
+  bool apply_version(const bookfeed::ConsolidatedBook& msg, OrderBook& book);
+  void nap(std::chrono::milliseconds d) const;
+
+  std::string endpoint_;
+  std::chrono::milliseconds keepalive_;
+
+  std::mutex call_mu_;
+  grpc::ClientContext* call_{nullptr};   // the open stream, for interrupt()
+
+  // Adapter thread only: decode and diff scratch, reused across versions.
+  FlatBook flat_;
+  OrderBook next_;
+  std::vector<Delta> bid_d_, ask_d_;
+
+  std::atomic<std::uint64_t> versions_{0};
+  std::atomic<std::uint64_t> connects_{0};
+};
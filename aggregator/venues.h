@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include "adapter_base.h"
+#include "binance_adapter.h"
+#include "kraken_adapter.h"
+#include "okx_adapter.h"
+#include "upstream_adapter.h"
+
+// Exchanges the aggregator has adapters for, plus kUpstream: another
+// aggregator's consolidated book (relay mode). Adding a venue means a new
+// adapter, an entry here and a case in make_adapter().
+enum class VenueKind { kBinance, kOkx, kKraken, kUpstream };
+
+// One venue's listing of an instrument: which exchange, its name for the
+// instrument, and its price increment.
+struct VenueSpec {
+  VenueKind kind;
+  std::string instrument;
+  double tick;
+  std::string endpoint{};   // kUpstream only: "host:port" of the upstream aggregator
+};
+
+inline std::unique_ptr<AdapterBase> make_adapter(const VenueSpec& v, FixedScale scale) {
+  switch (v.kind) {
+    case VenueKind::kBinance: return std::make_unique<BinanceAdapter>(v.instrument, scale, v.tick);
+    case VenueKind::kOkx:     return std::make_unique<OKXAdapter>(v.instrument, scale, v.tick);
+    case VenueKind::kKraken:  return std::make_unique<KrakenAdapter>(v.instrument, scale, v.tick);
+    case VenueKind::kUpstream:
+      return std::make_unique<UpstreamAdapter>(v.endpoint, v.instrument, scale, v.tick);
+  }
+  throw std::invalid_argument("make_adapter: unknown venue");
+}
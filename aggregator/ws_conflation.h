@@ -0,0 +1,59 @@
+#pragma once
+
+#include <poll.h>
+#include <boost/beast/core.hpp>
+#include <openssl/ssl.h>
+#include <chrono>
+#include <cstddef>
+#include <string_view>
+#include "adapter_base.h"
+
+// Whether another frame can be read from a TLS WebSocket without waiting past
+// deadline: decrypted bytes are pending in OpenSSL, raw bytes are waiting on
+// the socket, or bytes arrive before the deadline. Bytes still held inside
+// Beast's own read buffer are not visible here, so this may end a burst early
+// (the next read then returns at once); it never blocks past the deadline.
+template <class Ws>
+bool ws_frame_ready(Ws& ws, std::chrono::steady_clock::time_point deadline) {
+  if (SSL_pending(ws.next_layer().native_handle()) > 0) return true;
+
+  auto& sock = boost::beast::get_lowest_layer(ws).socket();
+  boost::system::error_code ec;
+  if (sock.available(ec) > 0 && !ec) return true;
+
+  const auto left = deadline - std::chrono::steady_clock::now();
+  if (left <= std::chrono::steady_clock::duration::zero()) return false;
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+  timespec ts{static_cast<time_t>(ns / 1'000'000'000), static_cast<long>(ns % 1'000'000'000)};
+  pollfd pfd{sock.native_handle(), POLLIN, 0};
+  return ::ppoll(&pfd, 1, &ts, nullptr) > 0;
+}
+
+// WebSocket frame buffers are reserved up front for the largest frame a
+// venue sends (book snapshots included) and reused for every read: clear()
+// keeps the storage, so steady-state reads allocate nothing.
+inline constexpr std::size_t kWsFrameReserve = 256 * 1024;
+
+// The frame held in a flat_buffer, in place; valid until the next read.
+inline std::string_view frame_view(const boost::beast::flat_buffer& buffer) {
+  const auto data = buffer.data();
+  return {static_cast<const char*>(data.data()), data.size()};
+}
+
+// Read one frame and hand it to apply as a view (frame_view); with conflation on, keep reading and
+// applying frames while more are ready (see ws_frame_ready), up to
+// cfg.max_frames. The caller publishes once afterwards. Returns the number of
+// frames applied; exceptions from read or apply propagate.
+template <class Ws, class Apply>
+std::size_t ws_read_burst(Ws& ws, boost::beast::flat_buffer& buffer, const AdapterBase::Conflation& cfg,
+                          Apply&& apply) {
+  const auto deadline = std::chrono::steady_clock::now() + cfg.window;
+  std::size_t n = 0;
+  do {
+    buffer.clear();
+    ws.read(buffer);
+    apply(frame_view(buffer));
+    ++n;
+  } while (cfg.enabled && n < cfg.max_frames && ws_frame_ready(ws, deadline));
+  return n;
+}
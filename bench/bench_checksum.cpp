@@ -0,0 +1,70 @@
+// CPU cost of verifying one venue checksum against a 400-level book.
+//
+//   okx:      okx_checksum, top 25 levels per side interleaved.
+//   kraken:   kraken_checksum, top 10 asks then top 10 bids.
+//   bytewise: the OKX string built in a std::string first, then a
+//             byte-at-a-time CRC-32 over it (the textbook way).
+//
+// Timings are thread CPU time per checksum.
+#include "../aggregator/book_checksum.h"
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+
+namespace {
+
+double thread_cpu_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+template <class F>
+double per_call(int rounds, std::uint64_t& sink, F f) {
+  const double t0 = thread_cpu_ns();
+  for (int r = 0; r < rounds; ++r) sink += f();
+  return (thread_cpu_ns() - t0) / rounds;
+}
+
+std::uint32_t bytewise_okx(const OrderBook& book) {
+  std::string s;
+  char buf[24];
+  auto add = [&](std::int64_t v, int dp) {
+    if (!s.empty()) s += ':';
+    s.append(buf, format_fixed(v, dp, buf));
+  };
+  auto bid = book.bids.begin();
+  auto ask = book.asks.begin();
+  for (int i = 0; i < 25; ++i) {
+    if (bid != book.bids.end()) { add(bid->first, book.scale.px_dp); add(bid->second, book.scale.qty_dp); ++bid; }
+    if (ask != book.asks.end()) { add(ask->first, book.scale.px_dp); add(ask->second, book.scale.qty_dp); ++ask; }
+  }
+  std::uint32_t c = 0xFFFFFFFFu;
+  for (unsigned char ch : s) {
+    c ^= ch;
+    for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+  }
+  return ~c;
+}
+
+}  // namespace
+
+int main() {
+  constexpr int kRounds = 100000;
+
+  OrderBook book;
+  for (int i = 0; i < 400; ++i) {
+    book.bids.set(book.scale.to_px(110000.0 - 0.1 * i), book.scale.to_qty(0.00012345 * (i + 1)));
+    book.asks.set(book.scale.to_px(110000.1 + 0.1 * i), book.scale.to_qty(0.5 + 0.01 * i));
+  }
+
+  std::uint64_t sink = 0;
+  const double okx = per_call(kRounds, sink, [&] { return static_cast<std::uint32_t>(okx_checksum(book)); });
+  const double kraken = per_call(kRounds, sink, [&] { return kraken_checksum(book, 1, 8); });
+  const double bytewise = per_call(kRounds / 10, sink, [&] { return bytewise_okx(book); });
+
+  std::printf("%10s %10s %12s\n", "okx ns", "kraken ns", "bytewise ns");
+  std::printf("%10.0f %10.0f %12.0f\n", okx, kraken, bytewise);
+  std::printf("(sink %llu)\n", static_cast<unsigned long long>(sink));
+}
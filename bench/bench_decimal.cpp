@@ -0,0 +1,69 @@
+// CPU cost of converting one venue decimal string ("110000.01",
+// "0.00123400") to fixed point.
+//
+//   stod:       what the adapters did: copy into a std::string, std::stod
+//               (locale-aware), then round to the scale.
+//   from_chars: std::from_chars to double, then round to the scale.
+//   parse:      parse_fixed, straight to the scaled int64 (exact).
+//
+// Timings are thread CPU time per string.
+#include "../common/fixed_point.h"
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+double thread_cpu_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+template <class F>
+double per_string(const std::vector<std::string>& in, int rounds, std::int64_t& sink, F f) {
+  const double t0 = thread_cpu_ns();
+  for (int r = 0; r < rounds; ++r)
+    for (const auto& s : in) sink += f(std::string_view(s));
+  return (thread_cpu_ns() - t0) / (double(rounds) * in.size());
+}
+
+}  // namespace
+
+int main() {
+  constexpr int kRounds = 200;
+  const int dp = 8;
+
+  std::vector<std::string> prices, sizes;
+  char buf[64];
+  for (int i = 0; i < 1000; ++i) {
+    std::snprintf(buf, sizeof(buf), "%.2f", 110000.0 + 0.01 * i);
+    prices.emplace_back(buf);
+    std::snprintf(buf, sizeof(buf), "%.8f", 0.00012345 * (i + 1));
+    sizes.emplace_back(buf);
+  }
+
+  std::printf("%8s %12s %16s %12s\n", "input", "stod ns", "from_chars ns", "parse ns");
+  for (const auto* in : {&prices, &sizes}) {
+    std::int64_t sink = 0;
+    const double stod = per_string(*in, kRounds, sink, [&](std::string_view s) {
+      return to_fixed(std::stod(std::string(s)), dp);
+    });
+    const double fc = per_string(*in, kRounds, sink, [&](std::string_view s) {
+      double v = 0;
+      std::from_chars(s.data(), s.data() + s.size(), v);
+      return to_fixed(v, dp);
+    });
+    const double parse = per_string(*in, kRounds, sink, [&](std::string_view s) {
+      std::int64_t v = 0;
+      parse_fixed(s, dp, v);
+      return v;
+    });
+    std::printf("%8s %12.1f %16.1f %12.1f   (%lld)\n", in == &prices ? "price" : "size", stod, fc,
+                parse, static_cast<long long>(sink));
+  }
+  return 0;
+}
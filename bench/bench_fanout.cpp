@@ -0,0 +1,106 @@
+// Per-subscriber CPU cost of sending one consolidated book to S streams.
+//
+//   before: every stream builds its own ConsolidatedBook (add_bids/add_asks)
+//           and gRPC serializes it for that stream.
+//   after:  the book is built once into a reused message and serialized once
+//           into a grpc::ByteBuffer; each stream's write only copies the
+//           ByteBuffer (a slice reference).
+//
+// Timings are thread CPU time per update, divided by the subscriber count.
+#include <grpcpp/grpcpp.h>
+#include <grpcpp/support/byte_buffer.h>
+#include <grpcpp/impl/codegen/proto_utils.h>
+#include "bookfeed.pb.h"
+#include "../common/order_book.h"
+
+#include <cstdio>
+#include <ctime>
+#include <vector>
+
+namespace {
+
+double thread_cpu_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// A topN=200 consolidated book around 110000 with a 0.1 tick.
+MapOrderBook make_book(int round) {
+  const FixedScale sc{};
+  MapOrderBook b{sc};
+  for (int i = 0; i < 200; ++i) {
+    b.bids.set(sc.to_px(110000.0 - 0.1 * i), sc.to_qty(0.001 * (i + 1 + round % 7)));
+    b.asks.set(sc.to_px(110000.1 + 0.1 * i), sc.to_qty(0.002 * (i + 1 + round % 5)));
+  }
+  return b;
+}
+
+void fill(const MapOrderBook& b, bookfeed::ConsolidatedBook& msg) {
+  const auto& sc = b.scale;
+  msg.set_ts_ms(1);
+  for (const auto& [p, s] : b.bids) {
+    auto* lv = msg.add_bids(); lv->set_price(sc.px_to_double(p)); lv->set_size(sc.qty_to_double(s));
+  }
+  for (const auto& [p, s] : b.asks) {
+    auto* lv = msg.add_asks(); lv->set_price(sc.px_to_double(p)); lv->set_size(sc.qty_to_double(s));
+  }
+}
+
+// What a stream's write does with its message: serialize into a ByteBuffer.
+template <class Msg>
+void wire(const Msg& m, grpc::ByteBuffer& out) {
+  bool own = false;
+  out.Clear();
+  grpc::SerializationTraits<Msg>::Serialize(m, &out, &own);
+}
+
+}  // namespace
+
+int main() {
+  grpc::internal::GrpcLibraryInitializer grpc_init_once;   // ByteBuffer needs the core library
+  grpc_init_once.summon();
+
+  constexpr int kUpdates = 200;
+  const std::vector<MapOrderBook> books = [] {
+    std::vector<MapOrderBook> v;
+    for (int i = 0; i < kUpdates; ++i) v.push_back(make_book(i));
+    return v;
+  }();
+
+  std::printf("%10s %18s %18s %8s\n", "subs", "before ns/sub", "after ns/sub", "ratio");
+  std::fflush(stdout);
+  for (int subs : {1, 10, 100, 1000}) {
+    grpc::ByteBuffer sink;
+    std::size_t bytes = 0;
+
+    const double t0 = thread_cpu_ns();
+    for (const auto& b : books) {
+      for (int s = 0; s < subs; ++s) {
+        bookfeed::ConsolidatedBook msg;
+        fill(b, msg);
+        wire(msg, sink);
+        bytes += sink.Length();
+      }
+    }
+    const double before = (thread_cpu_ns() - t0) / (double(kUpdates) * subs);
+
+    bookfeed::ConsolidatedBook shared_msg;
+    grpc::ByteBuffer shared_bytes;
+    const double t1 = thread_cpu_ns();
+    for (const auto& b : books) {
+      shared_msg.Clear();
+      fill(b, shared_msg);
+      wire(shared_msg, shared_bytes);
+      for (int s = 0; s < subs; ++s) {
+        wire(shared_bytes, sink);
+        bytes += sink.Length();
+      }
+    }
+    const double after = (thread_cpu_ns() - t1) / (double(kUpdates) * subs);
+
+    std::printf("%10d %18.0f %18.0f %7.1fx   (%zu bytes written)\n", subs, before, after,
+                before / after, bytes);
+  }
+  return 0;
+}
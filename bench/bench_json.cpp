@@ -0,0 +1,114 @@
+// CPU cost of turning one venue depth frame into level deltas.
+//
+//   before: nlohmann::json::parse builds a DOM (a heap node per field and
+//           level), then each level goes through std::stod on a copied
+//           std::string.
+//   after:  JsonCursor walks the frame bytes once and converts each price and
+//           size in place (parse_fixed); no DOM, no allocation.
+//
+// Timings are thread CPU time per frame, for Binance-style frames of L
+// levels per side.
+#include <nlohmann/json.hpp>
+#include "../aggregator/json_cursor.h"
+#include "../common/order_book.h"
+
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+namespace {
+
+double thread_cpu_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+std::string make_frame(int levels, int round) {
+  std::string f = R"({"e":"depthUpdate","E":1700000000000,"s":"BTCUSDT","U":)"
+                + std::to_string(1000 + round) + R"(,"u":)" + std::to_string(1000 + round) + R"(,"b":[)";
+  char buf[64];
+  for (int i = 0; i < levels; ++i) {
+    std::snprintf(buf, sizeof(buf), R"(%s["%.2f","%.8f"])", i ? "," : "", 110000.0 - 0.01 * i,
+                  0.001 * (i + 1 + round % 7));
+    f += buf;
+  }
+  f += R"(],"a":[)";
+  for (int i = 0; i < levels; ++i) {
+    std::snprintf(buf, sizeof(buf), R"(%s["%.2f","%.8f"])", i ? "," : "", 110000.01 + 0.01 * i,
+                  0.002 * (i + 1 + round % 5));
+    f += buf;
+  }
+  return f + "]}";
+}
+
+void with_dom(const std::string& frame, const FixedScale& sc, std::vector<Delta>& bids,
+              std::vector<Delta>& asks) {
+  auto j = nlohmann::json::parse(frame);
+  for (auto& lvl : j["b"])
+    bids.emplace_back(sc.to_px(std::stod(lvl[0].get<std::string>())),
+                      sc.to_qty(std::stod(lvl[1].get<std::string>())));
+  for (auto& lvl : j["a"])
+    asks.emplace_back(sc.to_px(std::stod(lvl[0].get<std::string>())),
+                      sc.to_qty(std::stod(lvl[1].get<std::string>())));
+}
+
+void with_cursor(const std::string& frame, const FixedScale& sc, std::vector<Delta>& bids,
+                 std::vector<Delta>& asks) {
+  JsonCursor c(frame);
+  auto collect = [&](std::vector<Delta>& out) {
+    c.elements([&] {
+      px_t p = 0;
+      int n = 0;
+      c.elements([&] {
+        if (n == 0) p = sc.parse_px(c.scalar());
+        else if (n == 1) out.emplace_back(p, sc.parse_qty(c.scalar()));
+        ++n;
+      });
+    });
+  };
+  c.fields([&](std::string_view key) {
+    if (key == "b") collect(bids);
+    else if (key == "a") collect(asks);
+  });
+}
+
+}  // namespace
+
+int main() {
+  constexpr int kFrames = 200;
+  const FixedScale sc{};
+
+  std::printf("%10s %18s %18s %8s\n", "levels", "before ns/frame", "after ns/frame", "ratio");
+  for (int levels : {10, 100, 1000}) {
+    std::vector<std::string> frames;
+    for (int i = 0; i < kFrames; ++i) frames.push_back(make_frame(levels, i));
+    std::vector<Delta> bids, asks;
+    bids.reserve(levels);
+    asks.reserve(levels);
+    std::size_t check = 0;
+
+    const double t0 = thread_cpu_ns();
+    for (const auto& f : frames) {
+      bids.clear();
+      asks.clear();
+      with_dom(f, sc, bids, asks);
+      check += bids.size() + asks.size();
+    }
+    const double before = (thread_cpu_ns() - t0) / kFrames;
+
+    const double t1 = thread_cpu_ns();
+    for (const auto& f : frames) {
+      bids.clear();
+      asks.clear();
+      with_cursor(f, sc, bids, asks);
+      check += bids.size() + asks.size();
+    }
+    const double after = (thread_cpu_ns() - t1) / kFrames;
+
+    std::printf("%10d %18.0f %18.0f %7.1fx   (%zu levels)\n", levels, before, after,
+                before / after, check);
+  }
+  return 0;
+}
@@ -1,47 +1,150 @@
 #include <grpcpp/grpcpp.h>
 #include "bookfeed.grpc.pb.h"
+#include <chrono>
+#include <cstdlib>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include <string>
+#include <thread>
 
 #include "../../common/bands.h"
+#include "../../common/delta_book.h"
+#include "../../common/shm_book.h"
+
+static void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+static std::unique_ptr<ShmBookReader> open_shm(const std::string& name) {
+  for (;;) {
+    try {
+      return std::make_unique<ShmBookReader>(name);
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << ", retrying" << std::endl;
+      std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+  }
+}
+
+// Same-host path: read the aggregator's shared-memory segment in place.
+// Polls the write counter and prints each new top of book. While idle it
+// spins on the CPU's pause hint for a short while, then sleeps in 100 us
+// steps, checking about once a second whether the aggregator restarted (and
+// so replaced the segment), in which case it re-opens.
+static int run_shm(const std::string& name) {
+  constexpr std::uint64_t kSpins = 2048;
+  constexpr std::uint64_t kSleepsPerCheck = 10000;
+  std::unique_ptr<ShmBookReader> shm = open_shm(name);
+  FixedScale sc = shm->scale();
+
+  std::cout.setf(std::ios::fixed);
+  std::cout << std::setprecision(6);
+  std::uint64_t seen = 0;
+  std::uint64_t idle = 0;
+  for (;;) {
+    const std::uint64_t n = shm->written();
+    if (n == seen) {
+      if (++idle <= kSpins) {
+        cpu_relax();
+        continue;
+      }
+      if (shm->closed() || ((idle - kSpins) % kSleepsPerCheck == 0 && shm->replaced())) {
+        std::cerr << "segment " << name << " was replaced, re-opening" << std::endl;
+        shm.reset();
+        shm = open_shm(name);
+        sc = shm->scale();
+        seen = 0;
+        idle = 0;
+        continue;
+      }
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+      continue;
+    }
+    seen = n;
+    idle = 0;
+    std::int64_t ts = 0;
+    ShmLevel bid{}, ask{};
+    bool both = false;
+    shm->read_latest([&](const ShmBookView& v) {
+      ts = v.ts_ms;
+      both = !v.bids.empty() && !v.asks.empty();
+      if (both) {
+        bid = v.bids[0];
+        ask = v.asks[0];
+      }
+    });
+    if (!both) {
+      std::cout << "ts=" << ts << " BBO=NA" << std::endl;
+      continue;
+    }
+    std::cout << "ts=" << ts
+              << " bid=" << sc.px_to_double(bid.px) << "@" << sc.qty_to_double(bid.qty)
+              << " ask=" << sc.px_to_double(ask.px) << "@" << sc.qty_to_double(ask.qty)
+              << std::endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  const std::string symbol = argc > 1 ? argv[1] : "BTCUSDT";
+  if (const char* prefix = std::getenv("AGG_SHM_PREFIX"))
+    return run_shm(std::string("/") + prefix + "-" + symbol);
 
-int main() {
   auto channel = grpc::CreateChannel("aggregator:50051", grpc::InsecureChannelCredentials());
   auto stub = bookfeed::BookFeed::NewStub(channel);
 
   bookfeed::SubscribeRequest req; 
-  req.set_symbol("BTCUSDT");
-  grpc::ClientContext ctx;
-
-  std::unique_ptr<grpc::ClientReader<bookfeed::ConsolidatedBook>> reader(
-      stub->StreamBook(&ctx, req));
+  req.set_symbol(symbol);
+  req.set_depth(1);   // only the top level is read
 
   auto _flags = std::cout.flags();
   auto _prec  = std::cout.precision();
   std::cout.setf(std::ios::fixed);
   std::cout << std::setprecision(6);
 
-  bookfeed::ConsolidatedBook book;
-  while (reader->Read(&book)) {
-    double bid = 0, ask = 0, bsz = 0, asz = 0;
-    if (!compute_bbo(book, &bid, &bsz, &ask, &asz)) {
-      std::cout << "ts=" << book.ts_ms() << " BBO=NA" << std::endl;
-      continue;
+  // Deltas only carry the levels that changed; on a sequence gap, reopen the
+  // stream, which starts with a fresh snapshot.
+  grpc::Status status;
+  for (;;) {
+    grpc::ClientContext ctx;
+    std::unique_ptr<grpc::ClientReader<bookfeed::BookDelta>> reader(
+        stub->StreamBookDeltas(&ctx, req));
+
+    DeltaBook local;
+    bookfeed::BookDelta delta;
+    bool gap = false;
+    while (reader->Read(&delta)) {
+      if (!local.apply(delta)) {
+        std::cerr << "seq gap after " << local.seq() << ", resubscribing" << std::endl;
+        gap = true;
+        ctx.TryCancel();
+        break;
+      }
+      const auto& book = local.book();
+      double bid = 0, ask = 0, bsz = 0, asz = 0;
+      if (!compute_bbo(book, &bid, &bsz, &ask, &asz)) {
+        std::cout << "ts=" << book.ts_ms() << " BBO=NA" << std::endl;
+        continue;
+      }
+      std::cout << "ts=" << book.ts_ms()
+                << " bid=" << bid << "@" << bsz
+                << " ask=" << ask << "@" << asz
+                << std::endl;
     }
-    std::cout << "ts=" << book.ts_ms()
-              << " bid=" << bid << "@" << bsz
-              << " ask=" << ask << "@" << asz
-              << std::endl;
+    status = reader->Finish();
+    if (!gap) break;
   }
 
   std::cout.flags(_flags);
   std::cout.precision(_prec);
 
-  grpc::Status status = reader->Finish();
   if (!status.ok()) {
     std::cerr << "Stream ended: " << status.error_message() << std::endl;
     return 1;
   }
   return 0;
 }
-
@@ -6,12 +6,14 @@
 #include <iomanip>
 
 #include "../../common/bands.h"
+#include "../../common/packed_book.h"
 
 int main() {
   auto channel = grpc::CreateChannel("aggregator:50051", grpc::InsecureChannelCredentials());
   auto stub = bookfeed::BookFeed::NewStub(channel);
 
   bookfeed::SubscribeRequest req; req.set_symbol("BTCUSDT");
+  req.set_encoding(bookfeed::PACKED);
   grpc::ClientContext ctx;
   auto reader = stub->StreamBook(&ctx, req);
 
@@ -22,23 +24,27 @@ int main() {
 
   std::array<int,5> bps{1,2,3,4,5};
   //std::array<int,5> bps{50,100,200,500,1000};
+  // book and levels are reused across messages, so decoding does not allocate
+  // once they have grown to the book's depth.
   bookfeed::ConsolidatedBook book;
+  FlatBook levels;
   while (reader->Read(&book)) {
-    double bb=0, ba=0, bs=0, asz=0;
-    if (!compute_bbo(book, &bb, &bs, &ba, &asz)) {
+    if (!unpack_levels(book, levels) || levels.bids.empty() || levels.asks.empty()) {
       std::cout << "ts="<< book.ts_ms() <<" BBO=NA"<< std::endl;
       continue;
     }
-    double mid = 0.5*(bb + ba);
+    const FixedScale& sc = levels.scale;
+    double mid = 0.5*(sc.px_to_double(levels.bids[0].price) + sc.px_to_double(levels.asks[0].price));
     for (int bp : bps) {
-      double up_px = mid * (1.0 + bp * 1e-4);
-      double dn_px = mid * (1.0 - bp * 1e-4);
-      double qty_up = 0.0, qty_dn = 0.0;
-      double vwap_up = vwap_asks_to_price(book.asks(), up_px, &qty_up);
-      double vwap_dn = vwap_bids_to_price(book.bids(), dn_px, &qty_dn);
+      // Band edges rounded inwards, as the double version compared exactly.
+      const px_t up_px = to_fixed_floor(mid * (1.0 + bp * 1e-4), sc.px_dp);
+      const px_t dn_px = to_fixed_ceil(mid * (1.0 - bp * 1e-4), sc.px_dp);
+      qty_t qty_up = 0, qty_dn = 0;
+      double vwap_up = vwap_asks_to_price(levels.asks, sc, up_px, &qty_up);
+      double vwap_dn = vwap_bids_to_price(levels.bids, sc, dn_px, &qty_dn);
       std::cout << "ts="<< book.ts_ms()
-                << " +"<< bp <<"bps qty="<< qty_up <<" vwap="<< vwap_up
-                << " | -"<< bp <<"bps qty="<< qty_dn <<" vwap="<< vwap_dn
+                << " +"<< bp <<"bps qty="<< sc.qty_to_double(qty_up) <<" vwap="<< vwap_up
+                << " | -"<< bp <<"bps qty="<< sc.qty_to_double(qty_dn) <<" vwap="<< vwap_dn
                 << std::endl;
     }
   }
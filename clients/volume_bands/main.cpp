@@ -6,12 +6,14 @@
 #include <iomanip>
 
 #include "../../common/bands.h"
+#include "../../common/packed_book.h"
 
 int main() {
   auto channel = grpc::CreateChannel("aggregator:50051", grpc::InsecureChannelCredentials());
   auto stub = bookfeed::BookFeed::NewStub(channel);
 
   bookfeed::SubscribeRequest req; req.set_symbol("BTCUSDT");
+  req.set_encoding(bookfeed::PACKED);
   grpc::ClientContext ctx;
   auto reader = stub->StreamBook(&ctx, req);
 
@@ -22,11 +24,16 @@ int main() {
 
   std::array<double,5> bands{5e4, 1e5, 2e5, 5e5, 1e6};
   //std::array<double,5> bands{1e6, 5e6, 1e7, 2.5e7, 5e7};
+  // book and levels are reused across messages, so decoding does not allocate
+  // once they have grown to the book's depth.
   bookfeed::ConsolidatedBook book;
+  FlatBook levels;
   while (reader->Read(&book)) {
+    if (!unpack_levels(book, levels)) continue;
     for (double N : bands) {
-      double qty = 0.0;
-      double vwap = vwap_for_notional_asks(book.asks(), N, &qty);
+      qty_t q = 0;
+      const double vwap = vwap_for_notional(levels.asks, levels.scale, N, &q);
+      const double qty = levels.scale.qty_to_double(q);
       const double filled = qty * vwap;
       std::cout << "ts=" << book.ts_ms()
                 << " notional=" << N
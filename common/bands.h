@@ -1,7 +1,9 @@
 
 #pragma once
 #include "bookfeed.pb.h"
+#include "order_book.h"
 #include <cmath>
+#include <span>
 
 /*
   - The ConsolidatedBook passed to compute_bbo() is assumed to be produced by
@@ -113,3 +115,67 @@ inline double vwap_for_notional_bids(const google::protobuf::RepeatedPtrField<bo
   return qty > 0 ? notional / qty : 0.0;
 }
 
+
+
+// Fixed-point variants over a consolidated side (best level first), e.g. the
+// levels of a consolidated OrderBook. Quantity and notional accumulate exactly
+// in integer units; only the returned VWAP is converted to double.
+using notional_t = __int128;
+
+inline double vwap_fixed(notional_t notional, qty_t qty, const FixedScale& sc) {
+  if (qty <= 0) return 0.0;
+  return static_cast<double>(notional) / static_cast<double>(qty)
+       / static_cast<double>(kPow10[sc.px_dp]);
+}
+
+// Consume asks up to price ceiling (inclusive). out_qty is in size units.
+inline double vwap_asks_to_price(std::span<const LevelPxSz> asks, const FixedScale& sc,
+                                 px_t up_to_price_inclusive, qty_t* out_qty) {
+  qty_t qty = 0; notional_t notional = 0;
+  for (const auto& lv : asks) {
+    if (lv.price > up_to_price_inclusive) break;
+    qty += lv.size;
+    notional += static_cast<notional_t>(lv.size) * lv.price;
+  }
+  if (out_qty) *out_qty = qty;
+  return vwap_fixed(notional, qty, sc);
+}
+
+// Consume bids down to price floor (inclusive). out_qty is in size units.
+inline double vwap_bids_to_price(std::span<const LevelPxSz> bids, const FixedScale& sc,
+                                 px_t down_to_price_inclusive, qty_t* out_qty) {
+  qty_t qty = 0; notional_t notional = 0;
+  for (const auto& lv : bids) {
+    if (lv.price < down_to_price_inclusive) break;
+    qty += lv.size;
+    notional += static_cast<notional_t>(lv.size) * lv.price;
+  }
+  if (out_qty) *out_qty = qty;
+  return vwap_fixed(notional, qty, sc);
+}
+
+// Volume band for a target notional in quote currency; same side-agnostic walk
+// for bids and asks. The last level is filled proportionally (rounded down to
+// the size scale).
+inline double vwap_for_notional(std::span<const LevelPxSz> side, const FixedScale& sc,
+                                double target_notional, qty_t* out_qty) {
+  if (out_qty) *out_qty = 0;
+  if (target_notional <= 0.0) return 0.0;
+
+  const notional_t target = static_cast<notional_t>(to_fixed(target_notional, sc.px_dp))
+                          * kPow10[sc.qty_dp];
+  qty_t qty = 0; notional_t notional = 0;
+  for (const auto& lv : side) {
+    const notional_t level_notional = static_cast<notional_t>(lv.size) * lv.price;
+    if (notional + level_notional >= target) {
+      qty += static_cast<qty_t>((target - notional) / lv.price);
+      if (out_qty) *out_qty = qty;
+      return vwap_fixed(target, qty, sc);
+    }
+    qty += lv.size;
+    notional += level_notional;
+  }
+
+  if (out_qty) *out_qty = qty;
+  return vwap_fixed(notional, qty, sc);
+}
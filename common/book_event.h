@@ -0,0 +1,61 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include "order_book.h"
+
+// One entry of a venue's delta stream (see AdapterBase::start(DeltaRing*)).
+//
+// A message is a run of events closed by kCommit: kReset starts a snapshot
+// (the receiver clears its copy), kBid/kAsk set one level (qty 0 removes), and
+// kCommit carries the adapter's message sequence number. The producer pushes
+// each message into the ring whole or not at all.
+struct BookEvent {
+  enum class Kind : std::uint8_t { kReset, kBid, kAsk, kCommit };
+  Kind kind{Kind::kCommit};
+  px_t px{};
+  qty_t qty{};
+  std::uint64_t seq{};   // kCommit only
+};
+
+// The consumer's copy of a venue book, rebuilt from BookEvents.
+//
+// Commits must arrive with consecutive sequence numbers. A gap means the
+// producer dropped a message (its ring was full); the replica then reports
+// itself out of sync until the snapshot the producer sends next (kReset).
+class BookReplica {
+public:
+  explicit BookReplica(OrderBook init = OrderBook{}) : book_(std::move(init)) {}
+
+  // Apply one event. Returns true when it commits a message and the replica
+  // is in sync, i.e. book() is worth publishing.
+  bool apply(const BookEvent& e) {
+    switch (e.kind) {
+      case BookEvent::Kind::kReset:
+        book_.bids.clear();
+        book_.asks.clear();
+        in_snapshot_ = true;
+        return false;
+      case BookEvent::Kind::kBid: book_.bids.set(e.px, e.qty); return false;
+      case BookEvent::Kind::kAsk: book_.asks.set(e.px, e.qty); return false;
+      case BookEvent::Kind::kCommit: break;
+    }
+    if (in_snapshot_) synced_ = true;
+    else if (synced_ && e.seq != seq_ + 1) { synced_ = false; ++gaps_; }
+    in_snapshot_ = false;
+    seq_ = e.seq;
+    if (synced_) book_.take_changes();
+    return synced_;
+  }
+
+  const OrderBook& book() const { return book_; }
+  bool synced() const { return synced_; }
+  std::uint64_t seq() const { return seq_; }
+  std::uint64_t gaps() const { return gaps_; }
+
+private:
+  OrderBook book_;
+  std::uint64_t seq_{0};
+  std::uint64_t gaps_{0};
+  bool synced_{false};
+  bool in_snapshot_{false};
+};
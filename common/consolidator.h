@@ -1,7 +1,15 @@
 #pragma once
 #include "order_book.h"
+#include "book_event.h"
+#include <algorithm>
 #include <vector>
 #include <cmath>
+#include <limits>
+#include <map>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
 
 struct ConsolidationCfg {
   double tick{0.1};
@@ -18,52 +26,270 @@ inline double ceil_to_tick(double p, double tick) {
 }
 
 
-inline OrderBook consolidate(const std::vector<OrderBook>& books, const ConsolidationCfg& cfg) {
-  OrderBook merged;
-  if (books.empty()) return merged;
+// Consolidated levels in flat, reusable buffers (best first). Prices are
+// bucket prices (bucket id * tick) in the books' price units.
+struct FlatBook {
+  FixedScale scale{};
+  px_t tick{1};
+  std::vector<LevelPxSz> bids, asks;
+};
 
+namespace detail {
+inline void check_cfg(const ConsolidationCfg& cfg) {
   if (!std::isfinite(cfg.tick) || cfg.tick <= 0.0)
     throw std::invalid_argument("ConsolidationCfg.tick must be finite and > 0");
 
   if (cfg.topN <= 0)
     throw std::invalid_argument("ConsolidationCfg.topN must be >= 1");
+}
 
-  constexpr long double SCALE = 100000000.0L; // 1e8
-  const long long tick_i = std::llround(static_cast<long double>(cfg.tick) * SCALE);
+inline const OrderBook& book_of(const OrderBook& ob) { return ob; }
+inline const OrderBook& book_of(const OrderBook* ob) { return *ob; }
 
-  std::map<long long,double,std::greater<long long>> bids_i;
-  std::map<long long,double,std::less<long long>>    asks_i;
+// K-way merge of already sorted venue sides: take the best head across venues,
+// fold it into the current bucket, and stop as soon as a (topN+1)-th bucket
+// would start. out receives bucket ids, converted to prices at the end.
+template <class Books, class SideOf, class Better, class BucketOf>
+void merge_top(Books books, SideOf side_of, std::size_t topN, px_t tick,
+               Better better, BucketOf bucket_of, std::vector<LevelPxSz>& out) {
+  using It = typename std::remove_cvref_t<decltype(side_of(book_of(books.front())))>::const_iterator;
+  struct Cursor { It it, end; };
+  std::vector<Cursor> heads;
+  heads.reserve(books.size());
+  for (const auto& b : books) heads.push_back({side_of(book_of(b)).begin(), side_of(book_of(b)).end()});
 
-  for (const auto& ob : books) {
-    for (const auto& kv : ob.bids) {
-      const long double p = static_cast<long double>(kv.first);
-      const double s = kv.second;
-      if (!(s > 0.0)) continue;
-      const long long p_i = static_cast<long long>(std::floor(p * SCALE));
-      const long long id  = p_i / tick_i; // floor for bids
-      bids_i[id] += s;
+  out.clear();
+  for (;;) {
+    Cursor* best = nullptr;
+    for (auto& c : heads) {
+      while (c.it != c.end && c.it->second <= 0) ++c.it;
+      if (c.it != c.end && (!best || better(c.it->first, best->it->first))) best = &c;
     }
-    for (const auto& kv : ob.asks) {
-      const long double p = static_cast<long double>(kv.first);
-      const double s = kv.second;
-      if (!(s > 0.0)) continue;
-      const long long p_i = static_cast<long long>(std::ceil(p * SCALE));
-      const long long id  = (p_i + tick_i - 1) / tick_i; // ceil for asks
-      asks_i[id] += s;
+    if (!best) break;
+    const auto [p, s] = *best->it;
+    ++best->it;
+
+    const px_t id = bucket_of(p);
+    if (!out.empty() && out.back().price == id) {
+      out.back().size += s;
+    } else {
+      if (out.size() == topN) break;
+      out.push_back({id, s});
     }
   }
+  for (auto& l : out) l.price *= tick;
+}
 
-  if (bids_i.size() > cfg.topN) { auto it=bids_i.begin(); std::advance(it, cfg.topN); bids_i.erase(it, bids_i.end()); }
-  if (asks_i.size() > cfg.topN) { auto it=asks_i.begin(); std::advance(it, cfg.topN); asks_i.erase(it, asks_i.end()); }
+// Books is a span of venue books, either by pointer or stored contiguously.
+template <class Books>
+void consolidate_books(Books books, const ConsolidationCfg& cfg, FlatBook& out) {
+  check_cfg(cfg);
+  out.bids.clear();
+  out.asks.clear();
+  if (books.empty()) return;
 
-  for (const auto& kv : bids_i) {
-    const long double price = (static_cast<long double>(kv.first) * static_cast<long double>(tick_i)) / SCALE;
-    merged.bids[static_cast<double>(price)] = kv.second;
-  }
-  for (const auto& kv : asks_i) {
-    const long double price = (static_cast<long double>(kv.first) * static_cast<long double>(tick_i)) / SCALE;
-    merged.asks[static_cast<double>(price)] = kv.second;
+  const FixedScale& scale = book_of(books.front()).scale;
+  for (const auto& b : books) {
+    if (book_of(b).scale != scale)
+      throw std::invalid_argument("consolidate: books use different fixed-point scales");
   }
+  const px_t tick_i = scale.tick_to_px(cfg.tick);
+  out.scale = scale;
+  out.tick = tick_i;
+
+  merge_top(books, [](const OrderBook& ob) -> auto& { return ob.bids; }, cfg.topN, tick_i,
+            std::greater<px_t>{}, [&](px_t p) { return floor_div(p, tick_i); }, out.bids);
+  merge_top(books, [](const OrderBook& ob) -> auto& { return ob.asks; }, cfg.topN, tick_i,
+            std::less<px_t>{}, [&](px_t p) { return ceil_div(p, tick_i); }, out.asks);
+}
+}  // namespace detail
+
+// Bucket ids are price / tick in integer price units: floor for bids, ceil for asks.
+// Walks each venue side only as deep as the topN buckets reach; out's buffers
+// are reused across calls. Neither overload copies the books.
+inline void consolidate_into(std::span<const OrderBook* const> books, const ConsolidationCfg& cfg,
+                             FlatBook& out) {
+  detail::consolidate_books(books, cfg, out);
+}
+inline void consolidate_into(std::span<const OrderBook> books, const ConsolidationCfg& cfg,
+                             FlatBook& out) {
+  detail::consolidate_books(books, cfg, out);
+}
+
+inline OrderBook consolidate(const std::vector<OrderBook>& books, const ConsolidationCfg& cfg) {
+  if (books.empty()) return OrderBook{};
+  detail::check_cfg(cfg);
+
+  FlatBook flat;
+  consolidate_into(std::span<const OrderBook>(books), cfg, flat);
+
+  OrderBook merged{flat.scale, flat.tick};
+  for (const auto& l : flat.bids) merged.bids.set(l.price, l.size);
+  for (const auto& l : flat.asks) merged.asks.set(l.price, l.size);
   return merged;
 }
 
+// Stateful consolidation over a fixed set of venues, fed level by level.
+//
+// Keeps each venue's levels and the aggregated size per tick bucket, so a
+// venue delta adjusts only the bucket it lands in, and emit() walks just the
+// topN buckets of each side. emit() returns exactly what consolidate() would
+// return for the venues' current books. dirty() says whether anything inside
+// the topN frontier of the last emit() changed since.
+//
+// The buckets do not depend on depth, so several consumers at one tick can
+// share an engine: each cuts its own depth with emit(depth, frontier), asks
+// touched(frontier) whether its book changed, and clear_changes() is called
+// once all of them have looked.
+class IncrementalConsolidator {
+public:
+  // Where one emitted book ends: its last bucket id per side, or the side's
+  // `none` value when the side had fewer buckets than the depth asked for
+  // (every bucket is then in view).
+  struct Frontier {
+    px_t bid{std::numeric_limits<px_t>::min()};
+    px_t ask{std::numeric_limits<px_t>::max()};
+  };
+
+  IncrementalConsolidator(FixedScale scale, const ConsolidationCfg& cfg, std::size_t venues)
+    : scale_(scale), cfg_(cfg), venues_(venues) {
+    detail::check_cfg(cfg);
+    tick_i_ = scale.tick_to_px(cfg.tick);
+  }
+
+  std::size_t venues() const { return venues_.size(); }
+  const FixedScale& scale() const { return scale_; }
+  // Bucket width in price units; emitted prices are multiples of it.
+  px_t tick() const { return tick_i_; }
+
+  // Set a venue's size at price p (0 removes).
+  void set_bid(std::size_t v, px_t p, qty_t q) { set(venues_[v].bids, bids_, floor_div(p, tick_i_), p, q); }
+  void set_ask(std::size_t v, px_t p, qty_t q) { set(venues_[v].asks, asks_, ceil_div(p, tick_i_), p, q); }
+
+  // Drop all of a venue's levels.
+  void reset(std::size_t v) {
+    auto& venue = venues_[v];
+    for (const auto& [p, s] : venue.bids) add(bids_, floor_div(p, tick_i_), -s);
+    for (const auto& [p, s] : venue.asks) add(asks_, ceil_div(p, tick_i_), -s);
+    venue.bids.clear();
+    venue.asks.clear();
+  }
+
+  // Replace a venue's levels with those of book.
+  template <class Book>
+  void load(std::size_t v, const Book& book) {
+    if (book.scale != scale_)
+      throw std::invalid_argument("IncrementalConsolidator: book uses a different fixed-point scale");
+    reset(v);
+    for (const auto& [p, s] : book.bids) set_bid(v, p, s);
+    for (const auto& [p, s] : book.asks) set_ask(v, p, s);
+  }
+
+  // Apply one delta-stream event for venue v (kCommit is ignored).
+  void apply(std::size_t v, const BookEvent& e) {
+    switch (e.kind) {
+      case BookEvent::Kind::kReset: reset(v); break;
+      case BookEvent::Kind::kBid: set_bid(v, e.px, e.qty); break;
+      case BookEvent::Kind::kAsk: set_ask(v, e.px, e.qty); break;
+      case BookEvent::Kind::kCommit: break;
+    }
+  }
+
+  bool dirty() const { return !emitted_ || touched(frontier_); }
+
+  // The consolidated topN book; O(topN).
+  OrderBook emit() {
+    FlatBook flat;
+    emit(cfg_.topN, frontier_, flat);
+    clear_changes();
+    emitted_ = true;
+    OrderBook merged{scale_, tick_i_};
+    for (const auto& l : flat.bids) merged.bids.set(l.price, l.size);
+    for (const auto& l : flat.asks) merged.asks.set(l.price, l.size);
+    return merged;
+  }
+
+  // The top `depth` buckets of each side into out, and where they end;
+  // O(depth), and no allocation once out's buffers have grown to depth.
+  void emit(std::size_t depth, Frontier& f, FlatBook& out) const {
+    out.scale = scale_;
+    out.tick = tick_i_;
+    f.bid = emit_side(bids_, out.bids, depth, std::numeric_limits<px_t>::min());
+    f.ask = emit_side(asks_, out.asks, depth, std::numeric_limits<px_t>::max());
+  }
+
+  // Whether a bucket inside f changed since clear_changes().
+  bool touched(const Frontier& f) const {
+    return (bid_changed_ && best_bid_change_ >= f.bid) || (ask_changed_ && best_ask_change_ <= f.ask);
+  }
+  void clear_changes() {
+    bid_changed_ = ask_changed_ = false;
+    best_bid_change_ = std::numeric_limits<px_t>::min();
+    best_ask_change_ = std::numeric_limits<px_t>::max();
+  }
+
+private:
+  struct Venue {
+    std::unordered_map<px_t, qty_t> bids, asks;
+  };
+  template <class Compare>
+  using Buckets = std::map<px_t, qty_t, Compare>;   // bucket id -> total size
+
+  template <class Compare>
+  void set(std::unordered_map<px_t, qty_t>& levels, Buckets<Compare>& buckets,
+           px_t id, px_t p, qty_t q) {
+    // consolidate() ignores non-positive sizes, so they count as removals.
+    if (q < 0) q = 0;
+    auto it = levels.find(p);
+    const qty_t old = it == levels.end() ? 0 : it->second;
+    if (q == old) return;
+    if (q == 0) levels.erase(it);
+    else if (it == levels.end()) levels.emplace(p, q);
+    else it->second = q;
+    add(buckets, id, q - old);
+  }
+
+  template <class Compare>
+  void add(Buckets<Compare>& buckets, px_t id, qty_t d) {
+    if (d == 0) return;
+    auto [it, inserted] = buckets.try_emplace(id, 0);
+    it->second += d;
+    if (it->second == 0) buckets.erase(it);
+    // Only the best changed bucket matters: a frontier is touched if that one
+    // is at least as good as it.
+    if constexpr (std::is_same_v<Compare, std::greater<px_t>>) {
+      bid_changed_ = true;
+      best_bid_change_ = std::max(best_bid_change_, id);
+    } else {
+      ask_changed_ = true;
+      best_ask_change_ = std::min(best_ask_change_, id);
+    }
+  }
+
+  // Copy the top `depth` buckets into out; returns the last bucket id, or
+  // `none` if the side has fewer than depth buckets.
+  template <class Compare>
+  px_t emit_side(const Buckets<Compare>& buckets, std::vector<LevelPxSz>& out, std::size_t depth,
+                 px_t none) const {
+    out.clear();
+    std::size_t n = 0;
+    px_t last = none;
+    for (auto it = buckets.begin(); it != buckets.end() && n < depth; ++it, ++n) {
+      out.push_back({it->first * tick_i_, it->second});
+      last = it->first;
+    }
+    return n < depth ? none : last;
+  }
+
+  FixedScale scale_;
+  ConsolidationCfg cfg_;
+  px_t tick_i_{1};
+  std::vector<Venue> venues_;
+  Buckets<std::greater<px_t>> bids_;
+  Buckets<std::less<px_t>> asks_;
+  Frontier frontier_;          // of the last emit()
+  bool emitted_{false};
+  bool bid_changed_{false}, ask_changed_{false};
+  px_t best_bid_change_{std::numeric_limits<px_t>::min()};
+  px_t best_ask_change_{std::numeric_limits<px_t>::max()};
+};
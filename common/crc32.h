@@ -0,0 +1,70 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace detail {
+// Slicing tables: [0] is the bytewise table, [s] advances a byte s more zeros.
+using Crc32Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+constexpr Crc32Tables make_crc32_tables() {
+  Crc32Tables t{};
+  for (std::uint32_t i = 0; i < 256; ++i) {
+    std::uint32_t c = i;
+    for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+    t[0][i] = c;
+  }
+  for (std::uint32_t i = 0; i < 256; ++i)
+    for (std::size_t s = 1; s < 8; ++s) t[s][i] = t[0][t[s - 1][i] & 0xFF] ^ (t[s - 1][i] >> 8);
+  return t;
+}
+
+inline constexpr Crc32Tables kCrc32Tables = make_crc32_tables();
+}  // namespace detail
+
+// CRC-32 (IEEE 802.3 / zlib: reflected polynomial 0xEDB88320), the checksum
+// OKX and Kraken put on their book messages. Slicing-by-8: eight table
+// lookups per 8 input bytes, a few hundred ns for a 25-level book string.
+// (The SSE4.2 crc32 instruction computes CRC-32C, a different polynomial, so
+// it cannot be used for these.)
+//
+// Incremental: feed the pieces of the message as they are produced, no need
+// to assemble the string first.
+class Crc32 {
+public:
+  Crc32& update(const void* data, std::size_t n) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    std::uint32_t c = crc_;
+    while (n >= 8) {
+      std::uint32_t lo, hi;
+      std::memcpy(&lo, p, 4);
+      std::memcpy(&hi, p + 4, 4);
+      lo = to_le(lo) ^ c;
+      hi = to_le(hi);
+      c = kTables[7][lo & 0xFF] ^ kTables[6][(lo >> 8) & 0xFF] ^ kTables[5][(lo >> 16) & 0xFF]
+        ^ kTables[4][lo >> 24] ^ kTables[3][hi & 0xFF] ^ kTables[2][(hi >> 8) & 0xFF]
+        ^ kTables[1][(hi >> 16) & 0xFF] ^ kTables[0][hi >> 24];
+      p += 8;
+      n -= 8;
+    }
+    while (n--) c = kTables[0][(c ^ *p++) & 0xFF] ^ (c >> 8);
+    crc_ = c;
+    return *this;
+  }
+  Crc32& update(char c) { return update(&c, 1); }
+
+  std::uint32_t value() const { return ~crc_; }
+
+  static std::uint32_t of(const void* data, std::size_t n) { return Crc32{}.update(data, n).value(); }
+
+private:
+  static std::uint32_t to_le(std::uint32_t v) {
+    if constexpr (std::endian::native == std::endian::big) return __builtin_bswap32(v);
+    return v;
+  }
+
+  static constexpr const auto& kTables = detail::kCrc32Tables;
+  std::uint32_t crc_{0xFFFFFFFFu};
+};
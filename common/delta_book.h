@@ -0,0 +1,62 @@
+#pragma once
+#include "bookfeed.pb.h"
+#include <cstdint>
+#include <functional>
+#include <map>
+
+// Client side of StreamBookDeltas: the consolidated book rebuilt from the
+// stream's snapshot and the deltas after it.
+class DeltaBook {
+public:
+  // Apply one stream message. Returns false if it does not follow the
+  // previous one (a message was missed): the book is then out of sync until
+  // the next snapshot, and the caller should reopen the stream to get one.
+  bool apply(const bookfeed::BookDelta& d) {
+    if (d.snapshot()) {
+      bids_.clear();
+      asks_.clear();
+      synced_ = true;
+    } else if (!synced_ || (d.base_seq() != 0 ? d.base_seq() : d.seq() - 1) != seq_) {
+      synced_ = false;
+      return false;
+    }
+    for (const auto& l : d.bids()) set(bids_, l);
+    for (const auto& l : d.asks()) set(asks_, l);
+    seq_ = d.seq();
+    ts_ms_ = d.ts_ms();
+    stale_ = true;
+    return true;
+  }
+
+  bool synced() const { return synced_; }
+  std::uint64_t seq() const { return seq_; }
+
+  // The book as a ConsolidatedBook (best first), for compute_bbo() and the
+  // band helpers; rebuilt only after a change.
+  const bookfeed::ConsolidatedBook& book() {
+    if (stale_) {
+      book_.Clear();
+      book_.set_ts_ms(ts_ms_);
+      book_.set_version(seq_);
+      for (const auto& [p, s] : bids_) { auto* l = book_.add_bids(); l->set_price(p); l->set_size(s); }
+      for (const auto& [p, s] : asks_) { auto* l = book_.add_asks(); l->set_price(p); l->set_size(s); }
+      stale_ = false;
+    }
+    return book_;
+  }
+
+private:
+  template <class Side>
+  static void set(Side& side, const bookfeed::Level& l) {
+    if (l.size() > 0) side[l.price()] = l.size();
+    else side.erase(l.price());
+  }
+
+  std::map<double, double, std::greater<double>> bids_;
+  std::map<double, double> asks_;
+  std::uint64_t seq_{0};
+  std::int64_t ts_ms_{0};
+  bool synced_{false};
+  bool stale_{true};
+  bookfeed::ConsolidatedBook book_;
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+// Prices and sizes are carried as int64 counts of 10^-dp units, where dp is
+// fixed per instrument (see FixedScale). Conversion from the venue's decimal
+// representation happens once, when an adapter parses a message; everything
+// downstream (books, deltas, consolidation, bands) works on exact integers.
+using px_t  = std::int64_t;
+using qty_t = std::int64_t;
+
+inline constexpr std::array<std::int64_t, 19> kPow10 = {
+  1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+  100000000LL, 1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL,
+  10000000000000LL, 100000000000000LL, 1000000000000000LL,
+  10000000000000000LL, 100000000000000000LL, 1000000000000000000LL
+};
+
+inline std::int64_t to_fixed(double v, int dp) {
+  return std::llround(v * static_cast<double>(kPow10[dp]));
+}
+// Directional variants, for callers that must not round a price across a boundary.
+inline std::int64_t to_fixed_floor(double v, int dp) {
+  return static_cast<std::int64_t>(std::floor(v * static_cast<double>(kPow10[dp])));
+}
+inline std::int64_t to_fixed_ceil(double v, int dp) {
+  return static_cast<std::int64_t>(std::ceil(v * static_cast<double>(kPow10[dp])));
+}
+inline double from_fixed(std::int64_t v, int dp) {
+  return static_cast<double>(v) / static_cast<double>(kPow10[dp]);
+}
+
+// Integer division rounding towards -inf / +inf (tick bucketing for bids / asks).
+inline std::int64_t floor_div(std::int64_t a, std::int64_t b) {
+  std::int64_t q = a / b;
+  if ((a % b != 0) && ((a < 0) != (b < 0))) --q;
+  return q;
+}
+inline std::int64_t ceil_div(std::int64_t a, std::int64_t b) {
+  std::int64_t q = a / b;
+  if ((a % b != 0) && ((a < 0) == (b < 0))) ++q;
+  return q;
+}
+
+namespace detail {
+// SWAR digit runs (little-endian): whether 8 bytes are all ASCII digits, and
+// their value.
+inline bool is_eight_digits(std::uint64_t w) {
+  return ((w & 0xF0F0F0F0F0F0F0F0ULL) | (((w + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))
+         == 0x3333333333333333ULL;
+}
+inline std::uint64_t eight_digits(std::uint64_t w) {
+  w -= 0x3030303030303030ULL;
+  w = w * 10 + (w >> 8);
+  w = (((w & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)))
+       + (((w >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+  return w & 0xFFFFFFFFULL;
+}
+
+inline bool is_digit(char c) { return static_cast<unsigned>(c - '0') < 10; }
+
+// Append up to max - n digits from [p, end) to acc (8 at a time where
+// possible); stops at the first non-digit.
+inline const char* take_digits(const char* p, const char* end, std::uint64_t& acc, int& n, int max) {
+  if constexpr (std::endian::native == std::endian::little) {
+    while (max - n >= 8 && end - p >= 8) {
+      std::uint64_t w;
+      std::memcpy(&w, p, 8);
+      if (!is_eight_digits(w)) break;
+      acc = acc * 100000000ULL + eight_digits(w);
+      p += 8;
+      n += 8;
+    }
+  }
+  for (; n < max && p != end && is_digit(*p); ++p, ++n) acc = acc * 10 + static_cast<unsigned>(*p - '0');
+  return p;
+}
+}  // namespace detail
+
+// Parse an ASCII decimal ("-12.345", "0.00100000", "7") straight into
+// v * 10^dp, exactly: no double in between, no allocation, no locale.
+// Digits beyond dp are rounded half away from zero, as to_fixed() rounds.
+// Exponent forms ("1.5e-05") are rare on the wire and go through
+// std::from_chars. Returns false for anything else, or if the value does not
+// fit in 18 significant digits at this dp.
+inline bool parse_fixed(std::string_view s, int dp, std::int64_t& out) {
+  const char* p = s.data();
+  const char* const end = p + s.size();
+  bool neg = false;
+  if (p != end && (*p == '-' || *p == '+')) neg = *p++ == '-';
+
+  std::uint64_t acc = 0;
+  int ni = 0, nf = 0;
+  p = detail::take_digits(p, end, acc, ni, 19);
+  if (ni + dp > 18) return false;
+  bool digits = ni > 0, round_up = false;
+  if (p != end && *p == '.') {
+    p = detail::take_digits(p + 1, end, acc, nf, dp);
+    digits |= nf > 0;
+    if (p != end && detail::is_digit(*p)) {   // first digit past dp decides rounding
+      digits = true;
+      round_up = *p >= '5';
+      while (++p != end && detail::is_digit(*p)) {}
+    }
+  }
+  if (!digits) return false;
+  if (p != end) {
+    if (*p != 'e' && *p != 'E') return false;
+    double v = 0;
+    const auto r = std::from_chars(s.data(), end, v);
+    if (r.ec != std::errc{} || r.ptr != end || !(std::fabs(v) < 9.2e18 / static_cast<double>(kPow10[dp])))
+      return false;
+    out = to_fixed(v, dp);
+    return true;
+  }
+  acc = acc * static_cast<std::uint64_t>(kPow10[dp - nf]) + (round_up ? 1 : 0);
+  out = neg ? -static_cast<std::int64_t>(acc) : static_cast<std::int64_t>(acc);
+  return true;
+}
+
+// The inverse of parse_fixed: v * 10^-dp as the shortest decimal ("41006.8",
+// "7", "0.0001"), trailing fractional zeros dropped. Writes at most 21 chars
+// to out, returns the length.
+inline std::size_t format_fixed(std::int64_t v, int dp, char* out) {
+  char* p = out;
+  if (v < 0) *p++ = '-';
+  const std::uint64_t a = v < 0 ? 0 - static_cast<std::uint64_t>(v) : static_cast<std::uint64_t>(v);
+  const auto unit = static_cast<std::uint64_t>(kPow10[dp]);
+  p = std::to_chars(p, p + 20, a / unit).ptr;
+  std::uint64_t frac = a % unit;
+  if (frac != 0) {
+    int n = dp;
+    while (frac % 10 == 0) { frac /= 10; --n; }
+    *p++ = '.';
+    for (int i = n - 1; i >= 0; --i, frac /= 10) p[i] = static_cast<char>('0' + frac % 10);
+    p += n;
+  }
+  return static_cast<std::size_t>(p - out);
+}
+
+namespace detail {
+inline std::int64_t parse_or_throw(std::string_view s, int dp) {
+  std::int64_t v = 0;
+  if (!parse_fixed(s, dp, v)) throw std::invalid_argument("not a decimal number: " + std::string(s));
+  return v;
+}
+}  // namespace detail
+
+// Per-instrument fixed-point scale: decimal places kept for price and size.
+// 8/8 covers the BTC-USDT books of all three venues exactly.
+struct FixedScale {
+  int px_dp{8};
+  int qty_dp{8};
+
+  px_t   to_px(double p)  const { return to_fixed(p, px_dp); }
+  qty_t  to_qty(double q) const { return to_fixed(q, qty_dp); }
+  // Exact conversion of a venue's decimal string (see parse_fixed); throws
+  // std::invalid_argument, like std::stod, for text that is not a number.
+  px_t   parse_px(std::string_view s)  const { return detail::parse_or_throw(s, px_dp); }
+  qty_t  parse_qty(std::string_view s) const { return detail::parse_or_throw(s, qty_dp); }
+  double px_to_double(px_t p)   const { return from_fixed(p, px_dp); }
+  double qty_to_double(qty_t q) const { return from_fixed(q, qty_dp); }
+
+  // Convert a user-facing tick size (e.g. 0.1) to price units.
+  px_t tick_to_px(double tick) const {
+    if (!std::isfinite(tick) || tick <= 0.0)
+      throw std::invalid_argument("tick must be finite and > 0");
+    const px_t t = to_px(tick);
+    if (t <= 0) throw std::invalid_argument("tick is finer than the instrument price scale");
+    return t;
+  }
+
+  bool operator==(const FixedScale&) const = default;
+};
@@ -1,26 +1,167 @@
 #pragma once
 #include <map>
+#include <memory_resource>
+#include <span>
 #include <vector>
 #include <algorithm>
+#include "fixed_point.h"
+#include "price_ladder.h"
+#include "touch_mark.h"
 
-struct LevelPxSz { double price{}; double size{}; };
+struct LevelPxSz { px_t price{}; qty_t size{}; };
 
-struct OrderBook {
-  std::map<double,double,std::greater<double>> bids;
-  std::map<double,double,std::less<double>> asks;
+// One L2 delta: price -> new size (0 means remove).
+using Delta = std::pair<px_t,qty_t>;
+
+// One side of a book as an ordered std::map (best level first).
+// Side backends share this interface: set (0 removes), get, clear, size/empty,
+// and forward iteration over (price, size) pairs in price priority. Storage
+// comes from the given memory resource (e.g. a per-adapter pool).
+template <class Compare>
+class MapLevels {
+public:
+  using map_type = std::pmr::map<px_t,qty_t,Compare>;
+  using const_iterator = typename map_type::const_iterator;
+
+  explicit MapLevels(px_t /*tick*/ = 1,
+                     std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+    : map_(mr) {}
+
+  void set(px_t p, qty_t q) {
+    touch_.mark(p);
+    if (q == 0) { auto it = map_.find(p); if (it != map_.end()) map_.erase(it); }
+    else map_[p] = q;
+  }
+  qty_t get(px_t p) const {
+    auto it = map_.find(p);
+    return it == map_.end() ? 0 : it->second;
+  }
+  void clear() { map_.clear(); touch_.cleared = true; }
+  const TouchMark<Compare>& touched() const { return touch_; }
+  void reset_touched() { touch_ = {}; }
+  std::size_t size() const { return map_.size(); }
+  bool empty() const { return map_.empty(); }
+  const_iterator begin() const { return map_.begin(); }
+  const_iterator end() const { return map_.end(); }
+
+private:
+  map_type map_;
+  TouchMark<Compare> touch_;
 };
 
-// Apply L2 deltas: price -> new size (0 means remove)
-inline void apply_deltas(std::map<double,double,std::greater<double>>& side, const std::vector<std::pair<double,double>>& deltas) {
-  for (auto& [p, sz] : deltas) {
-    if (sz == 0.0) { auto it = side.find(p); if (it != side.end()) side.erase(it); }
-    else side[p] = sz;
+struct Bbo {
+  bool has_bid{false}, has_ask{false};
+  px_t bid_px{}; qty_t bid_sz{};
+  px_t ask_px{}; qty_t ask_sz{};
+  bool operator==(const Bbo&) const = default;
+};
+
+// What the writes since the last BasicOrderBook::take_changes() touched.
+struct BookChange {
+  bool bbo_changed{false};
+  bool bid_touched{false}, ask_touched{false};
+  bool bid_cleared{false}, ask_cleared{false};
+  px_t bid_px{}, ask_px{};   // most aggressive price written on each side
+
+  bool any() const { return bid_touched || ask_touched || bid_cleared || ask_cleared; }
+};
+
+// Book over a side backend: MapLevels (std::map) or LadderLevels (tick-indexed
+// ladder, see price_ladder.h). tick is the venue's price increment in price
+// units; only the ladder uses it.
+template <template <class> class Levels>
+struct BasicOrderBook {
+  FixedScale scale{};
+  Levels<std::greater<px_t>> bids;
+  Levels<std::less<px_t>> asks;
+
+  BasicOrderBook() = default;
+  explicit BasicOrderBook(FixedScale sc, px_t tick = 1,
+                          std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+    : scale(sc), bids(tick, mr), asks(tick, mr) {}
+
+  // Top of book as of the last take_changes().
+  const Bbo& bbo() const { return bbo_; }
+
+  // Collect and reset what was touched since the last call, refreshing the
+  // cached BBO.
+  BookChange take_changes() {
+    Bbo now;
+    if (!bids.empty()) { auto it = bids.begin(); now.has_bid = true; now.bid_px = it->first; now.bid_sz = it->second; }
+    if (!asks.empty()) { auto it = asks.begin(); now.has_ask = true; now.ask_px = it->first; now.ask_sz = it->second; }
+
+    BookChange ch;
+    ch.bbo_changed = !(now == bbo_);
+    ch.bid_touched = bids.touched().touched; ch.bid_px = bids.touched().px; ch.bid_cleared = bids.touched().cleared;
+    ch.ask_touched = asks.touched().touched; ch.ask_px = asks.touched().px; ch.ask_cleared = asks.touched().cleared;
+    bids.reset_touched();
+    asks.reset_touched();
+    bbo_ = now;
+    return ch;
   }
+
+private:
+  Bbo bbo_{};
+};
+
+using MapOrderBook = BasicOrderBook<MapLevels>;
+using LadderOrderBook = BasicOrderBook<LadderLevels>;
+
+// Backend used by the adapters and the aggregator; select with -DORDERBOOK_LADDER=ON.
+#ifdef ORDERBOOK_LADDER
+using OrderBook = LadderOrderBook;
+#else
+using OrderBook = MapOrderBook;
+#endif
+
+// Apply L2 deltas: price -> new size (0 means remove)
+template <class Side>
+inline void apply_deltas(Side& side, std::span<const Delta> deltas) {
+  for (auto& [p, sz] : deltas) side.set(p, sz);
+}
+template <class Side>
+inline void apply_deltas(Side& side, std::initializer_list<Delta> deltas) {
+  apply_deltas(side, std::span<const Delta>(deltas.begin(), deltas.size()));
 }
 
-inline void apply_deltas(std::map<double,double,std::less<double>>& side, const std::vector<std::pair<double,double>>& deltas) {
-  for (auto& [p, sz] : deltas) {
-    if (sz == 0.0) { auto it = side.find(p); if (it != side.end()) side.erase(it); }
-    else side[p] = sz;
+// The deltas that turn side `before` into side `after`, both ordered best
+// first by Compare: out(p, q) for each level added or resized (q = new size)
+// or removed (q = 0). One merge walk over both sides; each may be any range of
+// (price, size) pairs, e.g. a book side or a FlatBook side.
+template <class Compare, class Before, class After, class Out>
+inline void diff_sides(const Before& before, const After& after, Out out) {
+  const Compare better{};
+  auto b = before.begin(), be = before.end();
+  auto a = after.begin(), ae = after.end();
+  while (b != be || a != ae) {
+    if (a == ae) {
+      const auto& [bp, bq] = *b;
+      out(bp, qty_t{0});
+      ++b;
+      continue;
+    }
+    const auto& [ap, aq] = *a;
+    if (b == be) {
+      out(ap, aq);
+      ++a;
+      continue;
+    }
+    const auto& [bp, bq] = *b;
+    if (better(bp, ap)) {
+      out(bp, qty_t{0});
+      ++b;
+    } else if (better(ap, bp)) {
+      out(ap, aq);
+      ++a;
+    } else {
+      if (aq != bq) out(ap, aq);
+      ++a;
+      ++b;
+    }
   }
 }
+
+template <template <class> class Levels, class Compare, class Out>
+inline void diff_levels(const Levels<Compare>& before, const Levels<Compare>& after, Out out) {
+  diff_sides<Compare>(before, after, out);
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include "bookfeed.pb.h"
+#include "consolidator.h"
+#include "order_book.h"
+
+// The PACKED encoding of ConsolidatedBook (see bookfeed.proto): integer tick
+// counts, delta-coded per side, and integer sizes, instead of one Level
+// message per level.
+
+namespace detail {
+template <class Side, class Prices, class Sizes>
+void pack_side(const Side& side, px_t tick, Prices* px, Sizes* qty) {
+  px->Clear();
+  qty->Clear();
+  px_t prev = 0;
+  for (const auto& [p, s] : side) {
+    const px_t t = p / tick;
+    px->Add(t - prev);
+    qty->Add(s);
+    prev = t;
+  }
+}
+
+template <class Prices, class Sizes>
+bool unpack_side(const Prices& px, const Sizes& qty, px_t tick, std::vector<LevelPxSz>& out) {
+  out.clear();
+  if (px.size() != qty.size()) return false;
+  px_t t = 0;
+  for (int i = 0; i < px.size(); ++i) {
+    t += px.Get(i);
+    out.push_back({t * tick, qty.Get(i)});
+  }
+  return true;
+}
+}  // namespace detail
+
+// Fill msg's packed fields from a consolidated book whose prices are all
+// multiples of tick (price units). Leaves the Level fields alone.
+template <class Book>
+void pack_levels(const Book& book, px_t tick, bookfeed::ConsolidatedBook& msg) {
+  msg.set_px_dp(book.scale.px_dp);
+  msg.set_qty_dp(book.scale.qty_dp);
+  msg.set_px_tick(tick);
+  detail::pack_side(book.bids, tick, msg.mutable_bid_px(), msg.mutable_bid_qty());
+  detail::pack_side(book.asks, tick, msg.mutable_ask_px(), msg.mutable_ask_qty());
+}
+
+// Client side: decode msg's packed levels into out's buffers, which are reused
+// across calls (no allocation once they have grown to the book's depth).
+// Returns false for a malformed message.
+inline bool unpack_levels(const bookfeed::ConsolidatedBook& msg, FlatBook& out) {
+  if (msg.px_tick() <= 0 || msg.px_dp() < 0 || msg.px_dp() > 18 || msg.qty_dp() < 0 || msg.qty_dp() > 18)
+    return false;
+  out.scale = FixedScale{msg.px_dp(), msg.qty_dp()};
+  out.tick = msg.px_tick();
+  return detail::unpack_side(msg.bid_px(), msg.bid_qty(), out.tick, out.bids)
+      && detail::unpack_side(msg.ask_px(), msg.ask_qty(), out.tick, out.asks);
+}
@@ -0,0 +1,223 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "fixed_point.h"
+#include "touch_mark.h"
+
+// Tick-indexed price ladder for one side of a book.
+//
+// A ring of 2^k slots holds the sizes of a window of consecutive ticks that
+// starts a little ahead of the best level, so set/erase are O(1) array writes
+// and the best level is a tracked index. An occupancy bitmap makes "next
+// non-empty tick" a count-trailing-zeros scan. Levels that are off the tick
+// grid or beyond the window live in an ordered overflow map; iteration merges
+// both in price priority, so callers see the same ordering as a std::map side.
+//
+// The window re-centres itself when a better level arrives ahead of it, when
+// the window is empty, or when the best drifts past the middle of the window.
+template <class Compare>
+class LadderLevels {
+  static_assert(std::is_same_v<Compare, std::greater<px_t>> || std::is_same_v<Compare, std::less<px_t>>,
+                "LadderLevels orders by std::greater (bids) or std::less (asks)");
+  static constexpr bool kDescending = std::is_same_v<Compare, std::greater<px_t>>;
+  static constexpr long long kNone = std::numeric_limits<long long>::max();
+
+public:
+  using value_type = std::pair<px_t, qty_t>;
+  using overflow_type = std::pmr::map<px_t, qty_t, Compare>;
+  static constexpr std::size_t kDefaultWindow = 8192;
+
+  // tick: price units per slot (the venue's price increment).
+  // window: slots per side, rounded up to a power of two.
+  explicit LadderLevels(px_t tick = 1, std::size_t window = kDefaultWindow,
+                        std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+    : tick_(tick > 0 ? tick : 1),
+      slots_(std::bit_ceil(std::max<std::size_t>(window, 64)), 0, mr),
+      occ_(slots_.size() / 64, 0, mr),
+      w_(static_cast<long long>(slots_.size())),
+      mask_(slots_.size() - 1),
+      overflow_(mr) {}
+  LadderLevels(px_t tick, std::pmr::memory_resource* mr)
+    : LadderLevels(tick, kDefaultWindow, mr) {}
+
+  // Set the size at price p; 0 removes the level.
+  void set(px_t p, qty_t q) {
+    touch_.mark(p);
+    if (p % tick_ != 0) { set_overflow(p, q); return; }
+    const long long r = rank(p);
+    if (r < lo_ || r >= lo_ + w_) {
+      if (q == 0) { set_overflow(p, 0); return; }
+      // Follow the book when a better level shows up ahead of the window or
+      // the window has gone empty; deep levels simply spill to the overflow.
+      if (r < lo_ || count_ == 0) recenter(r - w_ / 4);
+      else { set_overflow(p, q); return; }
+    }
+    set_slot(r, q);
+  }
+
+  qty_t get(px_t p) const {
+    if (p % tick_ == 0) {
+      const long long r = rank(p);
+      if (r >= lo_ && r < lo_ + w_) return slots_[slot(r)];
+    }
+    auto it = overflow_.find(p);
+    return it == overflow_.end() ? 0 : it->second;
+  }
+
+  void clear() {
+    if (count_ > 0) {
+      std::fill(slots_.begin(), slots_.end(), 0);
+      std::fill(occ_.begin(), occ_.end(), 0);
+    }
+    count_ = 0;
+    best_ = kNone;
+    overflow_.clear();
+    touch_.cleared = true;
+  }
+
+  const TouchMark<Compare>& touched() const { return touch_; }
+  void reset_touched() { touch_ = {}; }
+
+  std::size_t size() const { return count_ + overflow_.size(); }
+  bool empty() const { return size() == 0; }
+  px_t tick() const { return tick_; }
+  std::size_t window() const { return slots_.size(); }
+  std::size_t overflow_size() const { return overflow_.size(); }
+
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = LadderLevels::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = value_type;
+    struct pointer {
+      value_type v;
+      const value_type* operator->() const { return &v; }
+    };
+
+    const_iterator() = default;
+
+    reference operator*() const {
+      if (dense_first()) return {l_->px_of(r_), l_->slots_[l_->slot(r_)]};
+      return *o_;
+    }
+    pointer operator->() const { return {**this}; }
+
+    const_iterator& operator++() {
+      if (dense_first()) r_ = l_->next_rank(r_ + 1);
+      else ++o_;
+      return *this;
+    }
+    const_iterator operator++(int) { auto t = *this; ++*this; return t; }
+
+    bool operator==(const const_iterator& o) const { return r_ == o.r_ && o_ == o.o_; }
+
+  private:
+    friend class LadderLevels;
+    const_iterator(const LadderLevels* l, long long r, typename overflow_type::const_iterator o)
+      : l_(l), r_(r), o_(o) {}
+
+    bool dense_first() const {
+      if (r_ == kNone) return false;
+      if (o_ == l_->overflow_.end()) return true;
+      return Compare{}(l_->px_of(r_), o_->first);
+    }
+
+    const LadderLevels* l_{nullptr};
+    long long r_{kNone};
+    typename overflow_type::const_iterator o_{};
+  };
+
+  const_iterator begin() const { return {this, count_ ? best_ : kNone, overflow_.begin()}; }
+  const_iterator end() const { return {this, kNone, overflow_.end()}; }
+
+private:
+  // Rank grows away from the touch on both sides: price/tick for asks, -price/tick for bids.
+  long long rank(px_t p) const { return kDescending ? -(p / tick_) : p / tick_; }
+  px_t px_of(long long r) const { return kDescending ? -r * tick_ : r * tick_; }
+  std::size_t slot(long long r) const { return static_cast<std::size_t>(r) & mask_; }
+
+  void set_overflow(px_t p, qty_t q) {
+    if (q == 0) overflow_.erase(p);
+    else overflow_[p] = q;
+  }
+
+  void set_slot(long long r, qty_t q) {
+    const std::size_t i = slot(r);
+    const qty_t old = slots_[i];
+    slots_[i] = q;
+    if (old == 0 && q != 0) {
+      occ_[i >> 6] |= (1ULL << (i & 63));
+      if (count_++ == 0 || r < best_) best_ = r;
+    } else if (old != 0 && q == 0) {
+      occ_[i >> 6] &= ~(1ULL << (i & 63));
+      if (--count_ == 0) { best_ = kNone; return; }
+      if (r == best_) {
+        best_ = next_rank(r + 1);
+        if (best_ - lo_ > w_ / 2) recenter(best_ - w_ / 4);
+      }
+    }
+  }
+
+  // Smallest occupied rank in [r, lo_ + w_), or kNone.
+  long long next_rank(long long r) const {
+    const long long end = lo_ + w_;
+    while (r < end) {
+      const std::size_t i = slot(r);
+      const std::uint64_t word = occ_[i >> 6] >> (i & 63);
+      if (word) {
+        const long long hit = r + std::countr_zero(word);
+        return hit < end ? hit : kNone;
+      }
+      r += 64 - static_cast<long long>(i & 63);
+    }
+    return kNone;
+  }
+
+  // Move the window to start at new_lo: evict dense levels that fall outside it
+  // into the overflow, then pull on-grid overflow levels that now fit.
+  void recenter(long long new_lo) {
+    for (long long r = count_ ? next_rank(lo_) : kNone; r != kNone; r = next_rank(r + 1)) {
+      if (r >= new_lo && r < new_lo + w_) continue;
+      const std::size_t i = slot(r);
+      overflow_.emplace(px_of(r), slots_[i]);
+      slots_[i] = 0;
+      occ_[i >> 6] &= ~(1ULL << (i & 63));
+      --count_;
+    }
+    lo_ = new_lo;
+
+    const px_t win_end = px_of(lo_ + w_);
+    for (auto it = overflow_.lower_bound(px_of(lo_));
+         it != overflow_.end() && Compare{}(it->first, win_end);) {
+      if (it->first % tick_ != 0) { ++it; continue; }
+      const std::size_t i = slot(rank(it->first));
+      slots_[i] = it->second;
+      occ_[i >> 6] |= (1ULL << (i & 63));
+      ++count_;
+      it = overflow_.erase(it);
+    }
+    best_ = count_ ? next_rank(lo_) : kNone;
+  }
+
+  px_t tick_;
+  std::pmr::vector<qty_t> slots_;
+  std::pmr::vector<std::uint64_t> occ_;
+  long long w_;
+  std::size_t mask_;
+  long long lo_{0};
+  long long best_{kNone};
+  std::size_t count_{0};
+  overflow_type overflow_;
+  TouchMark<Compare> touch_;
+};
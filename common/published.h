@@ -0,0 +1,79 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <utility>
+
+// Single-writer publication of immutable versions (RCU style).
+//
+// The writer copies its state into an off-to-the-side version and swaps the
+// pointer in; readers take a shared_ptr to whatever is current and keep it as
+// long as they like. Neither side holds a lock while copying or reading the
+// payload; the only shared step is the pointer swap / refcount bump.
+//
+// Reclamation: a version is freed when its last reader drops it. The writer
+// keeps the version it just retired and, once no reader holds it any more,
+// reuses its storage for the next copy (so a std::map payload reuses nodes
+// and steady-state publishing does not allocate).
+template <class T>
+class Published {
+public:
+  explicit Published(T initial = T{})
+    : cur_(std::make_shared<T>(std::move(initial))) {}
+
+  Published(const Published&) = delete;
+  Published& operator=(const Published&) = delete;
+
+  // Readers: any thread.
+  std::shared_ptr<const T> load() const {
+#if defined(__cpp_lib_atomic_shared_ptr)
+    return cur_.load(std::memory_order_acquire);
+#else
+    return std::atomic_load_explicit(&cur_, std::memory_order_acquire);
+#endif
+  }
+
+  // Writer: one thread at a time.
+  void publish(const T& v) {
+    std::shared_ptr<T> next = spare();
+    if (next) *next = v;
+    else next = std::make_shared<T>(v);
+    retired_ = std::const_pointer_cast<T>(swap_in(std::move(next)));
+  }
+
+  // Writer: build the next version in place with fill(T&), then publish it.
+  // fill gets either recycled storage holding an older version or a
+  // default-constructed T, so it must overwrite everything it relies on.
+  template <class F>
+  void update(F&& fill) {
+    std::shared_ptr<T> next = spare();
+    if (!next) next = std::make_shared<T>();
+    fill(*next);
+    retired_ = std::const_pointer_cast<T>(swap_in(std::move(next)));
+  }
+
+private:
+  // The retired version, if no reader can reach it any more.
+  std::shared_ptr<T> spare() {
+    if (!retired_ || retired_.use_count() != 1) return nullptr;
+    // Pair with the readers' release of their references before touching
+    // its storage.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return std::move(retired_);
+  }
+
+  std::shared_ptr<const T> swap_in(std::shared_ptr<T> next) {
+#if defined(__cpp_lib_atomic_shared_ptr)
+    return cur_.exchange(std::move(next), std::memory_order_acq_rel);
+#else
+    return std::atomic_exchange_explicit(&cur_, std::shared_ptr<const T>(std::move(next)),
+                                         std::memory_order_acq_rel);
+#endif
+  }
+
+#if defined(__cpp_lib_atomic_shared_ptr)
+  std::atomic<std::shared_ptr<const T>> cur_;
+#else
+  std::shared_ptr<const T> cur_;
+#endif
+  std::shared_ptr<T> retired_;
+};
@@ -0,0 +1,251 @@
+#pragma once
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include "order_book.h"
+
+// Consolidated books in a POSIX shared-memory segment, for consumers on the
+// same host: no serialization, no socket, and after open no syscalls.
+//
+// Layout (all fields fixed-size, native byte order): a ShmHeader, then
+// `slots` slots of stride bytes, each a ShmSlot followed by `depth` bid
+// levels and `depth` ask levels (ShmLevel, best first). Prices and sizes are
+// the aggregator's fixed-point integers; the header carries their scale.
+//
+// One writer fills slots round-robin, each under its own seqlock (seq is odd
+// while the slot is being written), and then bumps `written`. A reader takes
+// the slot of the latest write and reads it in place, retrying if the seq
+// moved meanwhile, so it never blocks the writer and never sees a torn book.
+//
+// A restarted writer unlinks the old segment and creates a new one; readers
+// of the old one see `closed` set on a clean shutdown, and a changed inode
+// under the name (replaced()) either way, and re-open.
+
+inline constexpr std::uint64_t kShmMagic = 0x4b4f4f4242474741ULL;   // "AGGBBOOK"
+inline constexpr std::uint32_t kShmLayout = 2;
+
+struct ShmLevel {
+  std::int64_t px;
+  std::int64_t qty;
+};
+
+struct alignas(64) ShmHeader {
+  std::uint64_t magic;
+  std::uint32_t layout;
+  std::uint32_t depth;    // levels per side per slot
+  std::uint32_t slots;
+  std::uint32_t stride;   // bytes per slot
+  std::int32_t px_dp;
+  std::int32_t qty_dp;
+  char symbol[32];
+  alignas(64) std::atomic<std::uint64_t> written;   // completed writes
+  std::atomic<std::uint32_t> closed;                 // set by the writer on shutdown
+};
+
+struct alignas(64) ShmSlot {
+  std::atomic<std::uint64_t> seq;
+  std::uint64_t version;   // ConsolidatedBook.version of this book
+  std::int64_t ts_ms;
+  std::uint32_t n_bids;
+  std::uint32_t n_asks;
+};
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free,
+              "seqlock counters must be lock-free to be shared across processes");
+
+// One consistent book as read from a slot; valid only inside the reader's
+// callback.
+struct ShmBookView {
+  std::uint64_t version;
+  std::int64_t ts_ms;
+  std::span<const ShmLevel> bids, asks;
+};
+
+namespace detail {
+inline std::size_t shm_stride(std::uint32_t depth) {
+  const std::size_t raw = sizeof(ShmSlot) + 2 * std::size_t{depth} * sizeof(ShmLevel);
+  return (raw + 63) / 64 * 64;
+}
+
+inline void* shm_map(const std::string& name, int flags, std::size_t& size, bool create,
+                     ino_t* ino = nullptr) {
+  const int fd = ::shm_open(name.c_str(), flags, 0644);
+  if (fd < 0) throw std::system_error(errno, std::generic_category(), "shm_open " + name);
+  if (create && ::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    const int err = errno;
+    ::close(fd);
+    throw std::system_error(err, std::generic_category(), "ftruncate " + name);
+  }
+  if (!create) {
+    struct stat st {};
+    if (::fstat(fd, &st) != 0) {
+      const int err = errno;
+      ::close(fd);
+      throw std::system_error(err, std::generic_category(), "fstat " + name);
+    }
+    size = static_cast<std::size_t>(st.st_size);
+    if (ino) *ino = st.st_ino;
+  }
+  const int prot = (flags & O_ACCMODE) == O_RDONLY ? PROT_READ : PROT_READ | PROT_WRITE;
+  void* p = ::mmap(nullptr, size, prot, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) throw std::system_error(errno, std::generic_category(), "mmap " + name);
+  return p;
+}
+}  // namespace detail
+
+// Aggregator side. Creates (or replaces) the segment `name` (e.g. "/agg-BTCUSDT").
+class ShmBookWriter {
+public:
+  ShmBookWriter(const std::string& name, const std::string& symbol, FixedScale scale,
+                std::uint32_t depth, std::uint32_t slots = 8)
+    : name_(name), depth_(depth ? depth : 1), slots_(slots ? slots : 1),
+      stride_(detail::shm_stride(depth_)), size_(sizeof(ShmHeader) + slots_ * stride_) {
+    ::shm_unlink(name_.c_str());   // readers of a previous run keep their old mapping
+    base_ = static_cast<std::byte*>(detail::shm_map(name_, O_CREAT | O_RDWR, size_, true));
+    auto* h = new (base_) ShmHeader{};
+    h->depth = depth_;
+    h->slots = slots_;
+    h->stride = static_cast<std::uint32_t>(stride_);
+    h->px_dp = scale.px_dp;
+    h->qty_dp = scale.qty_dp;
+    std::strncpy(h->symbol, symbol.c_str(), sizeof(h->symbol) - 1);
+    h->written.store(0, std::memory_order_relaxed);
+    h->closed.store(0, std::memory_order_relaxed);
+    for (std::uint32_t i = 0; i < slots_; ++i) new (base_ + sizeof(ShmHeader) + i * stride_) ShmSlot{};
+    h->layout = kShmLayout;
+    std::atomic_thread_fence(std::memory_order_release);
+    h->magic = kShmMagic;   // last: a reader that sees it sees a complete header
+  }
+  ~ShmBookWriter() {
+    header()->closed.store(1, std::memory_order_release);
+    ::munmap(base_, size_);
+    ::shm_unlink(name_.c_str());
+  }
+
+  ShmBookWriter(const ShmBookWriter&) = delete;
+  ShmBookWriter& operator=(const ShmBookWriter&) = delete;
+
+  const std::string& name() const { return name_; }
+
+  // Write the top `depth` levels of each side of book as the next slot.
+  template <class Book>
+  void write(std::uint64_t version, std::int64_t ts_ms, const Book& book) {
+    ShmHeader* h = header();
+    const std::uint64_t n = h->written.load(std::memory_order_relaxed);
+    std::byte* at = base_ + sizeof(ShmHeader) + (n % slots_) * stride_;
+    auto* slot = reinterpret_cast<ShmSlot*>(at);
+    auto* levels = reinterpret_cast<ShmLevel*>(at + sizeof(ShmSlot));
+
+    const std::uint64_t s = slot->seq.load(std::memory_order_relaxed);
+    slot->seq.store(s + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->version = version;
+    slot->ts_ms = ts_ms;
+    slot->n_bids = copy_side(book.bids, levels);
+    slot->n_asks = copy_side(book.asks, levels + depth_);
+    slot->seq.store(s + 2, std::memory_order_release);
+    h->written.store(n + 1, std::memory_order_release);
+  }
+
+private:
+  ShmHeader* header() { return reinterpret_cast<ShmHeader*>(base_); }
+
+  template <class Side>
+  std::uint32_t copy_side(const Side& side, ShmLevel* out) const {
+    std::uint32_t i = 0;
+    for (const auto& [p, s] : side) {
+      if (i == depth_) break;
+      out[i++] = ShmLevel{p, s};
+    }
+    return i;
+  }
+
+  std::string name_;
+  std::uint32_t depth_, slots_;
+  std::size_t stride_, size_;
+  std::byte* base_{nullptr};
+};
+
+// Consumer side: maps the segment read-only.
+class ShmBookReader {
+public:
+  explicit ShmBookReader(const std::string& name) : name_(name) {
+    base_ = static_cast<const std::byte*>(detail::shm_map(name, O_RDONLY, size_, false, &ino_));
+    const ShmHeader* h = header();
+    if (size_ < sizeof(ShmHeader) || h->magic != kShmMagic || h->layout != kShmLayout
+        || size_ < sizeof(ShmHeader) + std::size_t{h->slots} * h->stride
+        || h->stride < detail::shm_stride(h->depth)) {
+      ::munmap(const_cast<std::byte*>(base_), size_);
+      throw std::runtime_error("ShmBookReader: " + name + " is not a book segment of this layout");
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+  ~ShmBookReader() { ::munmap(const_cast<std::byte*>(base_), size_); }
+
+  ShmBookReader(const ShmBookReader&) = delete;
+  ShmBookReader& operator=(const ShmBookReader&) = delete;
+
+  FixedScale scale() const { return FixedScale{header()->px_dp, header()->qty_dp}; }
+  std::string symbol() const { return std::string(header()->symbol, strnlen(header()->symbol, sizeof(header()->symbol))); }
+  std::uint32_t depth() const { return header()->depth; }
+  // Books written so far; cheap enough to poll for a change.
+  std::uint64_t written() const { return header()->written.load(std::memory_order_acquire); }
+  // The writer shut down; nothing more will be written to this mapping.
+  bool closed() const { return header()->closed.load(std::memory_order_acquire) != 0; }
+  // Whether the name no longer refers to the mapped segment: it was removed,
+  // or a restarted writer replaced it (also after a crash, which leaves
+  // closed() unset). Three syscalls: check it when idle, not per poll.
+  bool replaced() const {
+    const int fd = ::shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) return true;
+    struct stat st {};
+    const bool same = ::fstat(fd, &st) == 0 && st.st_ino == ino_;
+    ::close(fd);
+    return !same;
+  }
+
+  // Call f(const ShmBookView&) on the latest book, in place. Returns false if
+  // nothing has been written yet. f may run more than once (when the writer
+  // overwrote the slot while f was reading it); only the last run saw a
+  // consistent book, so f should just read and keep what it needs.
+  template <class F>
+  bool read_latest(F&& f) const {
+    for (;;) {
+      const std::uint64_t n = written();
+      if (n == 0) return false;
+      const ShmHeader* h = header();
+      const std::byte* at = base_ + sizeof(ShmHeader) + ((n - 1) % h->slots) * h->stride;
+      const auto* slot = reinterpret_cast<const ShmSlot*>(at);
+      const auto* levels = reinterpret_cast<const ShmLevel*>(at + sizeof(ShmSlot));
+
+      const std::uint64_t s1 = slot->seq.load(std::memory_order_acquire);
+      if (s1 & 1) continue;
+      const ShmBookView view{slot->version, slot->ts_ms,
+                             {levels, std::min(slot->n_bids, h->depth)},
+                             {levels + h->depth, std::min(slot->n_asks, h->depth)}};
+      f(view);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot->seq.load(std::memory_order_relaxed) == s1) return true;
+    }
+  }
+
+private:
+  const ShmHeader* header() const { return reinterpret_cast<const ShmHeader*>(base_); }
+
+  std::string name_;
+  const std::byte* base_{nullptr};
+  std::size_t size_{0};
+  ino_t ino_{0};
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <new>
+#include <span>
+#include <vector>
+
+// Bounded lock-free single-producer / single-consumer ring.
+//
+// One thread pushes, one thread pops; neither blocks. Head and tail live on
+// separate cache lines, and each side caches the other's index so the shared
+// line is only re-read when the ring looks full (producer) or empty
+// (consumer). Batches are published with a single release store, so the
+// consumer sees a batch pushed by try_push(span) all at once or not at all.
+template <class T>
+class SpscRing {
+  static constexpr std::size_t kLine = 64;
+
+public:
+  // capacity is rounded up to a power of two.
+  explicit SpscRing(std::size_t capacity)
+    : buf_(std::bit_ceil(std::max<std::size_t>(capacity, 2))),
+      mask_(buf_.size() - 1) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  std::size_t capacity() const { return buf_.size(); }
+
+  // Producer: push one element; false if the ring is full.
+  bool try_push(const T& v) {
+    return try_push(std::span<const T>(&v, 1));
+  }
+
+  // Producer: push all of vs or nothing; false if they do not fit.
+  bool try_push(std::span<const T> vs) {
+    const std::size_t t = tail_.load(std::memory_order_relaxed);
+    if (vs.size() > buf_.size() - (t - head_cache_)) {
+      head_cache_ = head_.load(std::memory_order_acquire);
+      if (vs.size() > buf_.size() - (t - head_cache_)) return false;
+    }
+    for (std::size_t i = 0; i < vs.size(); ++i) buf_[(t + i) & mask_] = vs[i];
+    tail_.store(t + vs.size(), std::memory_order_release);
+    return true;
+  }
+
+  // Consumer: pop one element; false if the ring is empty.
+  bool try_pop(T& out) {
+    return drain([&](const T& v) { out = v; }, 1) == 1;
+  }
+
+  // Consumer: hand up to max available elements to f in order, then release
+  // their slots with one store. Returns the number consumed.
+  template <class F>
+  std::size_t drain(F&& f, std::size_t max = static_cast<std::size_t>(-1)) {
+    const std::size_t h = head_.load(std::memory_order_relaxed);
+    if (h == tail_cache_) {
+      tail_cache_ = tail_.load(std::memory_order_acquire);
+      if (h == tail_cache_) return 0;
+    }
+    const std::size_t n = std::min(tail_cache_ - h, max);
+    for (std::size_t i = 0; i < n; ++i) f(buf_[(h + i) & mask_]);
+    head_.store(h + n, std::memory_order_release);
+    return n;
+  }
+
+  // Either side; exact only when the other side is idle.
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  std::vector<T> buf_;
+  std::size_t mask_;
+
+  alignas(kLine) std::atomic<std::size_t> head_{0};  // written by the consumer
+  std::size_t tail_cache_{0};                        // consumer's view of tail_
+  alignas(kLine) std::atomic<std::size_t> tail_{0};  // written by the producer
+  std::size_t head_cache_{0};                        // producer's view of head_
+};
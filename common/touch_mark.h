@@ -0,0 +1,16 @@
+#pragma once
+#include "fixed_point.h"
+
+// Most aggressive price written to a side since the last reset, plus whether
+// the side was cleared (a snapshot, which touches everything).
+template <class Compare>
+struct TouchMark {
+  bool touched{false};
+  bool cleared{false};
+  px_t px{};
+
+  void mark(px_t p) {
+    if (!touched || Compare{}(p, px)) px = p;
+    touched = true;
+  }
+};
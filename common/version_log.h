@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// The most recent `capacity` entries of a numbered sequence, kept so that
+// readers which fell behind can replay them in order.
+//
+// One writer appends entries with consecutive numbers; any thread may fetch an
+// entry by number while it is still held. Entries are immutable and shared,
+// so a reader keeps its entry alive for as long as it needs it.
+template <class T>
+class VersionLog {
+public:
+  explicit VersionLog(std::size_t capacity) : ring_(capacity ? capacity : 1) {}
+
+  VersionLog(const VersionLog&) = delete;
+  VersionLog& operator=(const VersionLog&) = delete;
+
+  // Writer: seq must be one past the previous append (or anything, the first
+  // time).
+  void append(std::uint64_t seq, std::shared_ptr<const T> entry) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (newest_ != 0 && seq != newest_ + 1) clear_locked();
+    ring_[seq % ring_.size()] = std::move(entry);
+    newest_ = seq;
+    if (held_ < ring_.size()) ++held_;
+  }
+
+  // The entry numbered seq, or null if it is not in the log (not yet
+  // appended, or already overwritten).
+  std::shared_ptr<const T> at(std::uint64_t seq) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (seq == 0 || seq > newest_ || newest_ - seq >= held_) return nullptr;
+    return ring_[seq % ring_.size()];
+  }
+
+  std::uint64_t newest() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return newest_;
+  }
+
+private:
+  void clear_locked() {
+    for (auto& e : ring_) e.reset();
+    held_ = 0;
+  }
+
+  mutable std::mutex mu_;
+  std::vector<std::shared_ptr<const T>> ring_;
+  std::uint64_t newest_{0};
+  std::size_t held_{0};
+};
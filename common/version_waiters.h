@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Parking lot for consumers waiting on the next version of a Published value.
+//
+// A consumer that has already sent the latest version parks itself with the
+// version it has seen; the writer calls wake_all() after each publish, and
+// every parked waiter gets exactly one on_version() call. Waiters are woken
+// outside the lock, so on_version() may start I/O or re-park. A parked waiter
+// is never woken twice, and one that is not parked is never woken, so the
+// writer touches only consumers that are actually idle.
+class VersionWaiters {
+public:
+  class Waiter {
+  public:
+    virtual void on_version() = 0;
+  protected:
+    ~Waiter() = default;
+  };
+
+  // Park w unless a version newer than seen is already out (then returns
+  // false and the caller should go and read it).
+  bool park(Waiter* w, std::uint64_t seen) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (latest_ > seen) return false;
+    parked_.push_back(w);
+    return true;
+  }
+
+  // Take w off the lot. Returns false if it was not parked, i.e. a wake for
+  // it has been handed out (and its on_version() runs or has run).
+  bool unpark(Waiter* w) {
+    std::lock_guard<std::mutex> lk(mu_);
+    for (auto& p : parked_) {
+      if (p == w) {
+        p = parked_.back();
+        parked_.pop_back();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Writer only: record that version is out and wake everyone parked.
+  void wake_all(std::uint64_t version) {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      latest_ = version;
+      waking_.swap(parked_);
+    }
+    for (Waiter* w : waking_) w->on_version();
+    waking_.clear();
+  }
+
+private:
+  std::mutex mu_;
+  std::uint64_t latest_{0};
+  std::vector<Waiter*> parked_;
+  std::vector<Waiter*> waking_;   // writer only
+};
@@ -1,4 +1,6 @@
 #include <gtest/gtest.h>
+#include <string>
+#include <vector>
 #define private public
 #include "../aggregator/binance_adapter.h"
 #undef private
@@ -17,10 +19,10 @@ TEST(AdapterBinanceTest, SequenceChainAndDeletion) {
   EXPECT_EQ(last, 102);
   ASSERT_EQ(book.bids.size(), 2u);
   ASSERT_EQ(book.asks.size(), 1u);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->first, 100.0);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->second, 1.5);
-  EXPECT_DOUBLE_EQ(book.asks.begin()->first, 100.5);
-  EXPECT_DOUBLE_EQ(book.asks.begin()->second, 3.0);
+  EXPECT_EQ(book.bids.begin()->first, book.scale.to_px(100.0));
+  EXPECT_EQ(book.bids.begin()->second, book.scale.to_qty(1.5));
+  EXPECT_EQ(book.asks.begin()->first, book.scale.to_px(100.5));
+  EXPECT_EQ(book.asks.begin()->second, book.scale.to_qty(3.0));
 
   const std::string upd2 = R"({
     "U":103,"u":104,
@@ -30,11 +32,88 @@ TEST(AdapterBinanceTest, SequenceChainAndDeletion) {
   adp.apply_update_json(upd2, last, book);
   EXPECT_EQ(last, 104);
   ASSERT_EQ(book.bids.size(), 1u);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->first, 99.5);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->second, 2.0);
+  EXPECT_EQ(book.bids.begin()->first, book.scale.to_px(99.5));
+  EXPECT_EQ(book.bids.begin()->second, book.scale.to_qty(2.0));
   ASSERT_EQ(book.asks.size(), 1u);
-  EXPECT_DOUBLE_EQ(book.asks.begin()->second, 1.0);
+  EXPECT_EQ(book.asks.begin()->second, book.scale.to_qty(1.0));
 
   const std::string gap = R"({"U":200,"u":201,"b":[],"a":[]})";
-  EXPECT_THROW(adp.apply_update_json(gap, last, book), std::runtime_error);
+  EXPECT_THROW(adp.apply_update_json(gap, last, book), SequenceGap);
+}
+
+namespace {
+BinanceAdapter::Snapshot snapshot(long long last_update_id) {
+  const FixedScale scale;
+  BinanceAdapter::Snapshot snap;
+  snap.ok = true;
+  snap.last_update_id = last_update_id;
+  snap.bids = {{scale.to_px(100.0), scale.to_qty(1.0)}, {scale.to_px(99.0), scale.to_qty(2.0)}};
+  snap.asks = {{scale.to_px(101.0), scale.to_qty(3.0)}};
+  return snap;
+}
+}  // namespace
+
+// Buffered events the snapshot covers are dropped, the one straddling
+// lastUpdateId + 1 and everything after it is applied.
+TEST(AdapterBinanceTest, BridgeReplaysBufferedEventsOntoSnapshot) {
+  BinanceAdapter adp("BTCUSDT");
+  OrderBook book;
+  book.bids.set(book.scale.to_px(50.0), book.scale.to_qty(1.0));   // stale, replaced
+  long long last = 0;
+  std::vector<std::string> pending = {
+    R"({"U":90,"u":95,"b":[["100.0","9"]],"a":[]})",
+    R"({"U":96,"u":102,"b":[["100.0","0"]],"a":[]})",
+    R"({"U":103,"u":105,"b":[],"a":[["101.0","4"]]})",
+  };
+  ASSERT_TRUE(adp.bridge(snapshot(100), pending, last, book));
+  EXPECT_TRUE(pending.empty());
+  EXPECT_EQ(last, 105);
+  ASSERT_EQ(book.bids.size(), 1u);
+  EXPECT_EQ(book.bids.begin()->first, book.scale.to_px(99.0));
+  EXPECT_EQ(book.asks.begin()->second, book.scale.to_qty(4.0));
+
+  // Live updates continue from the bridged id.
+  adp.apply_update_json(R"({"U":106,"u":106,"b":[["98.0","1"]],"a":[]})", last, book);
+  EXPECT_EQ(last, 106);
+  EXPECT_EQ(book.bids.size(), 2u);
+}
+
+// A snapshot older than the buffered events cannot be bridged; the events are
+// kept for the next snapshot, and the published book (and the delta journal
+// behind it) is left alone.
+TEST(AdapterBinanceTest, BridgeRejectsSnapshotOlderThanBuffer) {
+  AdapterBase::DeltaRing ring(1 << 10);
+  BinanceAdapter adp("BTCUSDT");
+  adp.ring_ = &ring;
+  OrderBook book;
+  book.bids.set(book.scale.to_px(50.0), book.scale.to_qty(1.0));
+  long long last = 40;
+  std::vector<std::string> pending = {
+    R"({"U":96,"u":102,"b":[["100.0","0"]],"a":[]})",
+    R"({"U":103,"u":105,"b":[],"a":[]})",
+  };
+  EXPECT_FALSE(adp.bridge(snapshot(50), pending, last, book));
+  EXPECT_EQ(pending.size(), 2u);
+  EXPECT_EQ(last, 40);
+  ASSERT_EQ(book.bids.size(), 1u);
+  EXPECT_EQ(book.bids.begin()->first, book.scale.to_px(50.0));
+  EXPECT_TRUE(book.asks.empty());
+  EXPECT_TRUE(adp.journal_.empty());
+
+  ASSERT_TRUE(adp.bridge(snapshot(97), pending, last, book));
+  EXPECT_EQ(last, 105);
+  EXPECT_EQ(book.bids.size(), 1u);
+  ASSERT_FALSE(adp.journal_.empty());
+  EXPECT_EQ(adp.journal_.front().kind, BookEvent::Kind::kReset);
+}
+
+// A snapshot newer than everything buffered is taken as is.
+TEST(AdapterBinanceTest, BridgeWithSnapshotAheadOfBuffer) {
+  BinanceAdapter adp("BTCUSDT");
+  OrderBook book;
+  long long last = 0;
+  std::vector<std::string> pending = {R"({"U":96,"u":102,"b":[["100.0","0"]],"a":[]})"};
+  ASSERT_TRUE(adp.bridge(snapshot(200), pending, last, book));
+  EXPECT_EQ(last, 200);
+  EXPECT_EQ(book.bids.size(), 2u);
 }
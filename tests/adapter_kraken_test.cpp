@@ -1,6 +1,10 @@
 #include <gtest/gtest.h>
+#include <iterator>
+#include <string>
 #define private public
+#define protected public
 #include "../aggregator/kraken_adapter.h"
+#undef protected
 #undef private
 
 TEST(AdapterKrakenTest, SnapshotUpdateAndZeroQuantityDelete) {
@@ -18,8 +22,8 @@ TEST(AdapterKrakenTest, SnapshotUpdateAndZeroQuantityDelete) {
   adp.apply_ws_message(snap, book);
   ASSERT_EQ(book.bids.size(), 2u);
   ASSERT_EQ(book.asks.size(), 1u);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->first, 100.0);
-  EXPECT_DOUBLE_EQ(book.asks.begin()->first, 100.5);
+  EXPECT_EQ(book.bids.begin()->first, book.scale.to_px(100.0));
+  EXPECT_EQ(book.asks.begin()->first, book.scale.to_px(100.5));
 
   const std::string upd1 = R"({
     "channel":"book","type":"update",
@@ -27,8 +31,8 @@ TEST(AdapterKrakenTest, SnapshotUpdateAndZeroQuantityDelete) {
   })";
   adp.apply_ws_message(upd1, book);
   ASSERT_EQ(book.bids.size(), 1u);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->first, 99.5);
-  EXPECT_DOUBLE_EQ(book.asks.begin()->second, 1.0);
+  EXPECT_EQ(book.bids.begin()->first, book.scale.to_px(99.5));
+  EXPECT_EQ(book.asks.begin()->second, book.scale.to_qty(1.0));
 
   const std::string upd2 = R"({
     "channel":"book","type":"update",
@@ -36,5 +40,59 @@ TEST(AdapterKrakenTest, SnapshotUpdateAndZeroQuantityDelete) {
   })";
   adp.apply_ws_message(upd2, book);
   ASSERT_EQ(book.bids.size(), 1u);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->second, 1.1);
+  EXPECT_EQ(book.bids.begin()->second, book.scale.to_qty(1.1));
+}
+
+// A checksum that does not match the book clears it and asks run() to
+// resubscribe; updates are ignored until the fresh snapshot.
+TEST(AdapterKrakenTest, ChecksumMismatchClearsBookUntilNextSnapshot) {
+  KrakenAdapter adp("BTCUSDT");
+  OrderBook book;
+
+  adp.apply_ws_message(R"({"channel":"book","type":"snapshot","data":[{"symbol":"BTC/USDT",
+    "bids":[{"price":100.0,"qty":1.0},{"price":99.5,"qty":2.5}],"asks":[{"price":100.5,"qty":3.0}],
+    "checksum":2385075717}]})", book);
+  EXPECT_FALSE(adp.take_resubscribe());
+  ASSERT_EQ(book.bids.size(), 2u);
+
+  adp.apply_ws_message(R"({"channel":"book","type":"update","data":[{"symbol":"BTC/USDT",
+    "bids":[{"price":99.5,"qty":0}],"asks":[],"checksum":1506512020}]})", book);
+  EXPECT_FALSE(adp.take_resubscribe());
+  EXPECT_EQ(book.bids.size(), 1u);
+
+  adp.apply_ws_message(R"({"channel":"book","type":"update","data":[{"symbol":"BTC/USDT",
+    "bids":[{"price":99.0,"qty":1.0}],"asks":[],"checksum":1506512020}]})", book);
+  EXPECT_TRUE(adp.take_resubscribe());
+  EXPECT_EQ(adp.resubscribes(), 1u);
+  EXPECT_TRUE(book.bids.empty());
+  EXPECT_TRUE(book.asks.empty());
+
+  adp.apply_ws_message(R"({"channel":"book","type":"update","data":[{"symbol":"BTC/USDT",
+    "bids":[{"price":98.0,"qty":1.0}],"asks":[]}]})", book);
+  EXPECT_TRUE(book.bids.empty());
+
+  adp.apply_ws_message(R"({"channel":"book","type":"snapshot","data":[{"symbol":"BTC/USDT",
+    "bids":[{"price":100.0,"qty":1.0}],"asks":[{"price":100.5,"qty":3.0}],"checksum":1506512020}]})", book);
+  EXPECT_FALSE(adp.take_resubscribe());
+  EXPECT_EQ(book.bids.size(), 1u);
+}
+
+// Levels pushed past the subscribed depth are dropped, worst first.
+TEST(AdapterKrakenTest, UpdatesTruncateToSubscribedDepth) {
+  KrakenAdapter adp("BTCUSDT");
+  OrderBook book;
+  std::string snap = R"({"channel":"book","type":"snapshot","data":[{"bids":[)";
+  for (std::size_t i = 0; i < KrakenAdapter::kDepth; ++i)
+    snap += (i ? "," : "") + std::string(R"({"price":)") + std::to_string(1000 - i) + R"(,"qty":1})";
+  snap += R"(],"asks":[]}]})";
+  adp.apply_ws_message(snap, book);
+  ASSERT_EQ(book.bids.size(), KrakenAdapter::kDepth);
+
+  adp.apply_ws_message(R"({"channel":"book","type":"update","data":[{
+    "bids":[{"price":1001,"qty":1},{"price":1002,"qty":1}],"asks":[]}]})", book);
+  EXPECT_EQ(book.bids.size(), KrakenAdapter::kDepth);
+  EXPECT_EQ(book.bids.begin()->first, book.scale.to_px(1002));
+  auto worst = book.bids.begin();
+  std::advance(worst, KrakenAdapter::kDepth - 1);
+  EXPECT_EQ(worst->first, book.scale.to_px(1000 - static_cast<int>(KrakenAdapter::kDepth) + 3));
 }
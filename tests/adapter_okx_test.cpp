@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #define private public
+#define protected public
 #include "../aggregator/okx_adapter.h"
+#undef protected
 #undef private
 
 TEST(AdapterOKXTest, SnapshotDiffZeroDeleteAndDuplicateOverwrite) {
@@ -30,8 +32,8 @@ TEST(AdapterOKXTest, SnapshotDiffZeroDeleteAndDuplicateOverwrite) {
   })";
   adp.apply_update_json(diff1, book);
   ASSERT_EQ(book.bids.size(), 1u);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->first, 99.5);
-  EXPECT_DOUBLE_EQ(book.asks.begin()->second, 1.0);
+  EXPECT_EQ(book.bids.begin()->first, book.scale.to_px(99.5));
+  EXPECT_EQ(book.asks.begin()->second, book.scale.to_qty(1.0));
 
   const std::string diff2 = R"({
     "data": [{
@@ -42,6 +44,93 @@ TEST(AdapterOKXTest, SnapshotDiffZeroDeleteAndDuplicateOverwrite) {
   })";
   adp.apply_update_json(diff2, book);
   ASSERT_EQ(book.bids.size(), 1u);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->first, 99.5);
-  EXPECT_DOUBLE_EQ(book.bids.begin()->second, 1.0);
+  EXPECT_EQ(book.bids.begin()->first, book.scale.to_px(99.5));
+  EXPECT_EQ(book.bids.begin()->second, book.scale.to_qty(1.0));
+}
+
+// In delta mode the replica rebuilt from the ring must equal the adapter's book.
+TEST(AdapterOKXTest, DeltaModeReplicaTracksBook) {
+  OKXAdapter adp("BTC-USDT");
+  AdapterBase::DeltaRing ring(64);
+  adp.ring_ = &ring;
+  OrderBook book;
+  BookReplica replica;
+
+  auto pump = [&] {
+    ring.drain([&](const BookEvent& e) { replica.apply(e); });
+    ASSERT_TRUE(replica.synced());
+    ASSERT_TRUE(std::equal(book.bids.begin(), book.bids.end(),
+                           replica.book().bids.begin(), replica.book().bids.end()));
+    ASSERT_TRUE(std::equal(book.asks.begin(), book.asks.end(),
+                           replica.book().asks.begin(), replica.book().asks.end()));
+  };
+
+  adp.apply_update_json(R"({"action":"snapshot","data":[{"prevSeqId":-1,"seqId":1,
+    "bids":[["100","1"],["99","2"]],"asks":[["101","3"]]}]})", book);
+  adp.publish({}, book);
+  pump();
+
+  adp.apply_update_json(R"({"data":[{"prevSeqId":1,"seqId":2,"b":[["100","0"]],"a":[["102","4"]]}]})", book);
+  adp.publish({}, book);
+  pump();
+  EXPECT_EQ(replica.seq(), 2u);
+
+  // Fill the ring so the next message is dropped; the one after resends a snapshot.
+  for (int i = 0; i < 63; ++i) ASSERT_TRUE(ring.try_push(BookEvent{}));
+  adp.apply_update_json(R"({"data":[{"prevSeqId":2,"seqId":3,"b":[["98","5"]]}]})", book);
+  adp.publish({}, book);
+  EXPECT_EQ(adp.dropped_messages(), 1u);
+  ring.drain([](const BookEvent&) {});
+
+  adp.apply_update_json(R"({"data":[{"prevSeqId":3,"seqId":4,"a":[["101","0"]]}]})", book);
+  adp.publish({}, book);
+  pump();
+  EXPECT_EQ(replica.gaps(), 0u);
+}
+
+// A checksum that does not match the book clears it and asks run() to
+// resubscribe; updates are ignored until the fresh snapshot.
+TEST(AdapterOKXTest, ChecksumMismatchClearsBookUntilNextSnapshot) {
+  OKXAdapter adp("BTC-USDT");
+  OrderBook book;
+
+  // Book "100:1:100.5:3:99.5:2".
+  adp.apply_update_json(R"({"arg":{"channel":"books","instId":"BTC-USDT"},"action":"snapshot",
+    "data":[{"prevSeqId":-1,"seqId":1,"bids":[["100","1"],["99.5","2"]],"asks":[["100.5","3"]],
+    "checksum":-366148305}]})", book);
+  EXPECT_FALSE(adp.take_resubscribe());
+  EXPECT_EQ(book.bids.size(), 2u);
+
+  // Removing 100 leaves "99.5:2:100.5:3"; the venue says otherwise.
+  adp.apply_update_json(R"({"arg":{"channel":"books","instId":"BTC-USDT"},"action":"update",
+    "data":[{"prevSeqId":1,"seqId":2,"bids":[["100","0"]],"asks":[],"checksum":12345}]})", book);
+  EXPECT_TRUE(adp.take_resubscribe());
+  EXPECT_FALSE(adp.take_resubscribe());
+  EXPECT_EQ(adp.resubscribes(), 1u);
+  EXPECT_TRUE(book.bids.empty());
+  EXPECT_TRUE(book.asks.empty());
+
+  adp.apply_update_json(R"({"arg":{"channel":"books","instId":"BTC-USDT"},"action":"update",
+    "data":[{"prevSeqId":2,"seqId":3,"bids":[["98","1"]],"asks":[]}]})", book);
+  EXPECT_TRUE(book.bids.empty());
+
+  adp.apply_update_json(R"({"arg":{"channel":"books","instId":"BTC-USDT"},"action":"snapshot",
+    "data":[{"prevSeqId":-1,"seqId":10,"bids":[["99.5","2"]],"asks":[["100.5","3"]],
+    "checksum":-997577080}]})", book);
+  EXPECT_FALSE(adp.take_resubscribe());
+  EXPECT_EQ(book.bids.size(), 1u);
+  EXPECT_EQ(adp.last_seq_id, 10);
+}
+
+// A sequence gap is recovered the same way, without dropping the connection.
+TEST(AdapterOKXTest, SeqGapResubscribes) {
+  OKXAdapter adp("BTC-USDT");
+  OrderBook book;
+  adp.apply_update_json(R"({"action":"snapshot","data":[{"prevSeqId":-1,"seqId":1,
+    "bids":[["100","1"]],"asks":[["101","3"]]}]})", book);
+  adp.apply_update_json(R"({"data":[{"prevSeqId":5,"seqId":6,"b":[["99","1"]]}]})", book);
+  EXPECT_TRUE(adp.take_resubscribe());
+  EXPECT_TRUE(book.bids.empty());
+  EXPECT_FALSE(adp.got_ws_snapshot);
+  EXPECT_EQ(adp.last_seq_id, -1);
 }
@@ -0,0 +1,139 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+#define private public
+#define protected public
+#include "../aggregator/binance_adapter.h"
+#include "../aggregator/kraken_adapter.h"
+#include "../aggregator/okx_adapter.h"
+#undef protected
+#undef private
+
+// Global-heap allocations made by this thread while counting is on. Books use
+// the adapter's own pool, as in run(); the pool and the scratch arena only
+// reach the heap while warming up.
+namespace {
+thread_local bool counting = false;
+thread_local std::size_t allocations = 0;
+
+struct Count {
+  Count() { allocations = 0; counting = true; }
+  ~Count() { counting = false; }
+};
+}  // namespace
+
+// Every replaceable allocation form counts: scalar and array, plain and
+// over-aligned (the nothrow forms call these). All of them free with free().
+namespace {
+void* counted_alloc(std::size_t n, std::size_t align = 0) {
+  if (counting) ++allocations;
+  if (n == 0) n = 1;
+  void* p = align ? std::aligned_alloc(align, (n + align - 1) / align * align) : std::malloc(n);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+}  // namespace
+
+void* operator new(std::size_t n) { return counted_alloc(n); }
+void* operator new[](std::size_t n) { return counted_alloc(n); }
+void* operator new(std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void* operator new[](std::size_t n, std::align_val_t a) { return counted_alloc(n, static_cast<std::size_t>(a)); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+// Frames alternate between adding and removing a level, so book nodes are
+// freed and taken again every frame.
+template <class Make>
+std::vector<std::string> frames(int n, Make make) {
+  std::vector<std::string> out;
+  for (int i = 0; i < n; ++i) out.push_back(make(i));
+  return out;
+}
+}  // namespace
+
+// The counter sees array and over-aligned allocations too.
+TEST(AdapterAllocTest, CountsEveryAllocationForm) {
+  struct alignas(128) Wide { char b[128]; };
+  static void* volatile sink;   // keeps the allocations from being elided
+  Count c;
+  sink = new char[16];
+  delete[] static_cast<char*>(sink);
+  sink = new Wide;
+  delete static_cast<Wide*>(sink);
+  sink = new Wide[2];
+  delete[] static_cast<Wide*>(sink);
+  EXPECT_EQ(allocations, 3u);
+}
+
+TEST(AdapterAllocTest, BinanceSteadyStateParseAndApplyDoNotAllocate) {
+  BinanceAdapter adp("BTCUSDT");
+  OrderBook book{FixedScale{}, 1, &adp.book_pool_};
+  long long last = 100;
+  const auto fs = frames(200, [](int i) {
+    return R"({"e":"depthUpdate","U":)" + std::to_string(101 + i) + R"(,"u":)" + std::to_string(101 + i)
+         + R"(,"b":[["100.00","1.5"],["99.50",")" + (i % 2 ? "0" : "2.0")
+         + R"("]],"a":[["100.50","3.0"],["101.00",")" + (i % 2 ? "1.25" : "0") + R"("]]})";
+  });
+  for (int i = 0; i < 20; ++i) adp.apply_update_json(fs[i], last, book);
+  Count c;
+  for (int i = 20; i < 200; ++i) adp.apply_update_json(std::string_view(fs[i]), last, book);
+  EXPECT_EQ(allocations, 0u);
+  EXPECT_EQ(last, 300);
+}
+
+TEST(AdapterAllocTest, OkxSteadyStateParseApplyAndPushDoNotAllocate) {
+  OKXAdapter adp("BTC-USDT");
+  AdapterBase::DeltaRing ring(1 << 12);
+  adp.ring_ = &ring;
+  adp.journal_.reserve(4096);
+  OrderBook book{FixedScale{}, 1, &adp.book_pool_};
+  adp.apply_update_json(R"({"action":"snapshot","data":[{"prevSeqId":-1,"seqId":0,
+    "bids":[["100","1"],["99","2"]],"asks":[["101","3"]]}]})", book);
+  const auto fs = frames(200, [](int i) {
+    return R"({"arg":{"channel":"books","instId":"BTC-USDT"},"action":"update","data":[{"b":[["98",")"
+         + std::string(i % 2 ? "0" : "4") + R"("]],"a":[["101","3.5"]],"prevSeqId":)" + std::to_string(i)
+         + R"(,"seqId":)" + std::to_string(i + 1) + "}]}";
+  });
+  auto step = [&](const std::string& f) {
+    adp.apply_update_json(f, book);
+    adp.publish({}, book);
+  };
+  for (int i = 0; i < 20; ++i) step(fs[i]);
+  ring.drain([](const BookEvent&) {});
+  {
+    Count c;
+    for (int i = 20; i < 200; ++i) step(fs[i]);
+  }
+  EXPECT_EQ(allocations, 0u);
+  EXPECT_EQ(adp.dropped_messages(), 0u);
+  EXPECT_EQ(adp.last_seq_id, 200);
+}
+
+TEST(AdapterAllocTest, KrakenSteadyStateParseAndApplyDoNotAllocate) {
+  KrakenAdapter adp("BTCUSDT");
+  OrderBook book{FixedScale{}, 1, &adp.book_pool_};
+  adp.apply_ws_message(R"({"channel":"book","type":"snapshot","data":[{
+    "bids":[{"price":100.0,"qty":1.0}],"asks":[{"price":100.5,"qty":3.0}]}]})", book);
+  const auto fs = frames(200, [](int i) {
+    return R"({"channel":"book","type":"update","data":[{"symbol":"BTC/USDT","bids":[{"price":99.5,"qty":)"
+         + std::string(i % 2 ? "0" : "2.5") + R"(}],"asks":[],"checksum":)"
+         + std::string(i % 2 ? "1506512020" : "2385075717") + R"(,"timestamp":"2024-01-01T00:00:00Z"}]})";
+  });
+  for (int i = 0; i < 20; ++i) adp.apply_ws_message(fs[i], book);
+  Count c;
+  for (int i = 20; i < 200; ++i) adp.apply_ws_message(fs[i], book);
+  EXPECT_EQ(allocations, 0u);
+  EXPECT_EQ(book.bids.size(), 1u);   // the last frame removed 99.5
+  EXPECT_EQ(adp.resubscribes(), 0u);  // every checksum verified
+}
@@ -0,0 +1,72 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "../common/crc32.h"
+#include "../aggregator/book_checksum.h"
+
+// Expected values are zlib's crc32 of the strings spelled out in each test.
+
+TEST(Crc32Test, MatchesZlib) {
+  const std::string s = "123456789";
+  EXPECT_EQ(Crc32::of(s.data(), s.size()), 0xCBF43926u);
+  EXPECT_EQ(Crc32::of(nullptr, 0), 0u);
+}
+
+// Any split of the input gives the CRC of the whole, across the 8-byte stride.
+TEST(Crc32Test, IncrementalEqualsOneShot) {
+  std::string s;
+  for (int i = 0; i < 100; ++i) s += static_cast<char>('0' + i % 43);
+  const std::uint32_t whole = Crc32::of(s.data(), s.size());
+  for (std::size_t cut = 0; cut <= s.size(); ++cut) {
+    Crc32 crc;
+    crc.update(s.data(), cut).update(s.data() + cut, s.size() - cut);
+    EXPECT_EQ(crc.value(), whole) << cut;
+  }
+}
+
+// "3366.1:7:3366.8:9:3366:6:3368:8": bid, ask, bid, ask, trailing zeros dropped.
+TEST(BookChecksumTest, OkxInterleavesShortestDecimals) {
+  OrderBook book;
+  book.bids.set(book.scale.to_px(3366.1), book.scale.to_qty(7));
+  book.bids.set(book.scale.to_px(3366.0), book.scale.to_qty(6));
+  book.asks.set(book.scale.to_px(3366.8), book.scale.to_qty(9));
+  book.asks.set(book.scale.to_px(3368.0), book.scale.to_qty(8));
+  EXPECT_EQ(okx_checksum(book), -1881014294);
+}
+
+// A side that runs out stops contributing: "99.5:2:100.5:3" has no second ask.
+TEST(BookChecksumTest, OkxUnevenSides) {
+  OrderBook book;
+  book.bids.set(book.scale.to_px(99.5), book.scale.to_qty(2));
+  book.asks.set(book.scale.to_px(100.5), book.scale.to_qty(3));
+  EXPECT_EQ(okx_checksum(book), -997577080);
+  book.bids.set(book.scale.to_px(100), book.scale.to_qty(1));
+  // "100:1:100.5:3:99.5:2"
+  EXPECT_EQ(okx_checksum(book), -366148305);
+}
+
+// Asks then bids, price and quantity at the pair precision with the point and
+// leading zeros removed: "1005" "300000000" "1000" "100000000" "995" "250000000".
+TEST(BookChecksumTest, KrakenAsksThenBidsAtPairPrecision) {
+  OrderBook book;
+  book.bids.set(book.scale.to_px(100.0), book.scale.to_qty(1.0));
+  book.bids.set(book.scale.to_px(99.5), book.scale.to_qty(2.5));
+  book.asks.set(book.scale.to_px(100.5), book.scale.to_qty(3.0));
+  EXPECT_EQ(kraken_checksum(book, 1, 8), 2385075717u);
+  book.bids.set(book.scale.to_px(99.5), 0);
+  EXPECT_EQ(kraken_checksum(book, 1, 8), 1506512020u);
+}
+
+// Only the top 10 levels of each side count.
+TEST(BookChecksumTest, KrakenIgnoresLevelsPastTen) {
+  OrderBook book;
+  for (int i = 0; i < 10; ++i) {
+    book.bids.set(book.scale.to_px(100 - i), book.scale.to_qty(1));
+    book.asks.set(book.scale.to_px(101 + i), book.scale.to_qty(1));
+  }
+  const std::uint32_t top = kraken_checksum(book, 1, 8);
+  book.bids.set(book.scale.to_px(50), book.scale.to_qty(1));
+  book.asks.set(book.scale.to_px(150), book.scale.to_qty(1));
+  EXPECT_EQ(kraken_checksum(book, 1, 8), top);
+  book.bids.set(book.scale.to_px(100.5), book.scale.to_qty(1));
+  EXPECT_NE(kraken_checksum(book, 1, 8), top);
+}
@@ -1,45 +1,217 @@
 #include <gtest/gtest.h>
+#include <limits>
+#include <random>
 #include "../common/consolidator.h"
 
+static const FixedScale sc{};
+
 TEST(ConsolidatorTest, MergeAcrossSourcesWithTickAndTopN) {
   ConsolidationCfg cfg;
   cfg.tick = 0.5;
   cfg.topN = 2;
 
   OrderBook a, b;
-  a.bids[100.0] = 1.0;
-  a.bids[99.9]  = 2.0;      // -> 99.5 after floor_to_tick for bids
-  a.asks[100.5] = 3.0;
-  a.asks[100.6] = 1.0;      // -> 101.0 after ceil_to_tick for asks
+  a.bids.set(sc.to_px(100.0), sc.to_qty(1.0));
+  a.bids.set(sc.to_px(99.9),  sc.to_qty(2.0));      // -> 99.5 after floor_to_tick for bids
+  a.asks.set(sc.to_px(100.5), sc.to_qty(3.0));
+  a.asks.set(sc.to_px(100.6), sc.to_qty(1.0));      // -> 101.0 after ceil_to_tick for asks
 
-  b.bids[100.0] = 2.0;
-  b.bids[99.4]  = 1.0;      // -> 99.0 after floor_to_tick
-  b.asks[100.5] = 1.0;
-  b.asks[101.1] = 1.0;      // -> 101.5 after ceil_to_tick
+  b.bids.set(sc.to_px(100.0), sc.to_qty(2.0));
+  b.bids.set(sc.to_px(99.4),  sc.to_qty(1.0));      // -> 99.0 after floor_to_tick
+  b.asks.set(sc.to_px(100.5), sc.to_qty(1.0));
+  b.asks.set(sc.to_px(101.1), sc.to_qty(1.0));      // -> 101.5 after ceil_to_tick
 
   auto merged = consolidate({a, b}, cfg);
 
   ASSERT_GE(merged.bids.size(), 2u);
   auto itb = merged.bids.begin();
-  EXPECT_DOUBLE_EQ(itb->first, 100.0);
-  EXPECT_DOUBLE_EQ(itb->second, 3.0);
+  EXPECT_EQ(itb->first, sc.to_px(100.0));
+  EXPECT_EQ(itb->second, sc.to_qty(3.0));
   
   ++itb;
-  EXPECT_DOUBLE_EQ(itb->first, 99.5);
-  EXPECT_DOUBLE_EQ(itb->second, 2.0);
+  EXPECT_EQ(itb->first, sc.to_px(99.5));
+  EXPECT_EQ(itb->second, sc.to_qty(2.0));
 
   ++itb; 
   EXPECT_TRUE(itb == merged.bids.end());
 
   ASSERT_GE(merged.asks.size(), 2u);
   auto ita = merged.asks.begin();
-  EXPECT_DOUBLE_EQ(ita->first, 100.5);
-  EXPECT_DOUBLE_EQ(ita->second, 4.0);
+  EXPECT_EQ(ita->first, sc.to_px(100.5));
+  EXPECT_EQ(ita->second, sc.to_qty(4.0));
   
   ++ita;
-  EXPECT_DOUBLE_EQ(ita->first, 101.0);
-  EXPECT_DOUBLE_EQ(ita->second, 1.0);
+  EXPECT_EQ(ita->first, sc.to_px(101.0));
+  EXPECT_EQ(ita->second, sc.to_qty(1.0));
 
   ++ita;
   EXPECT_TRUE(ita == merged.asks.end());
 }
+
+TEST(ConsolidatorTest, RejectsMixedScales) {
+  OrderBook a, b;
+  b.scale.px_dp = 2;
+  EXPECT_THROW(consolidate({a, b}, ConsolidationCfg{}), std::invalid_argument);
+}
+
+static void expect_same_book(const OrderBook& a, const OrderBook& b) {
+  ASSERT_EQ(a.bids.size(), b.bids.size());
+  ASSERT_EQ(a.asks.size(), b.asks.size());
+  EXPECT_TRUE(std::equal(a.bids.begin(), a.bids.end(), b.bids.begin(), b.bids.end()));
+  EXPECT_TRUE(std::equal(a.asks.begin(), a.asks.end(), b.asks.begin(), b.asks.end()));
+}
+
+// Random deltas, resets and reloads across three venues: after every step the
+// incremental engine must emit exactly what consolidate() builds from scratch.
+TEST(IncrementalConsolidatorTest, MatchesFullRebuildUnderRandomDeltas) {
+  ConsolidationCfg cfg;
+  cfg.tick = 0.5;
+  cfg.topN = 5;
+  std::vector<OrderBook> books(3, OrderBook{sc});
+  IncrementalConsolidator inc(sc, cfg, books.size());
+
+  std::mt19937_64 rng(11);
+  for (int i = 0; i < 5000; ++i) {
+    const std::size_t v = rng() % books.size();
+    const px_t p = sc.to_px(100.0) + static_cast<px_t>(rng() % 400) * sc.to_px(0.01);
+    const qty_t q = rng() % 3 == 0 ? 0 : sc.to_qty(0.001) * static_cast<qty_t>(rng() % 50 + 1);
+    const int op = static_cast<int>(rng() % 100);
+    if (op == 0) {
+      books[v].bids.clear(); books[v].asks.clear();
+      inc.reset(v);
+    } else if (op == 1) {
+      OrderBook fresh{sc};
+      fresh.bids.set(p - sc.to_px(1.0), q + 1);
+      fresh.asks.set(p + sc.to_px(1.0), q + 1);
+      books[v] = fresh;
+      inc.load(v, fresh);
+    } else if (op % 2 == 0) {
+      books[v].bids.set(p - sc.to_px(2.0), q);
+      inc.set_bid(v, p - sc.to_px(2.0), q);
+    } else {
+      books[v].asks.set(p + sc.to_px(2.0), q);
+      inc.set_ask(v, p + sc.to_px(2.0), q);
+    }
+
+    const OrderBook want = consolidate(books, cfg);
+    const OrderBook got = inc.emit();
+    expect_same_book(got, want);
+    if (::testing::Test::HasFailure()) FAIL() << "diverged at step " << i;
+  }
+}
+
+TEST(IncrementalConsolidatorTest, DeltasBeyondTopNLeaveItClean) {
+  ConsolidationCfg cfg;
+  cfg.tick = 1.0;
+  cfg.topN = 2;
+  IncrementalConsolidator inc(sc, cfg, 2);
+  for (int i = 0; i < 5; ++i) {
+    inc.set_bid(0, sc.to_px(100.0 - i), sc.to_qty(1.0));
+    inc.set_ask(1, sc.to_px(101.0 + i), sc.to_qty(1.0));
+  }
+  inc.emit();
+  EXPECT_FALSE(inc.dirty());
+
+  inc.set_bid(1, sc.to_px(97.0), sc.to_qty(2.0));   // 4th bid bucket
+  inc.set_ask(0, sc.to_px(104.0), sc.to_qty(2.0));  // 4th ask bucket
+  EXPECT_FALSE(inc.dirty());
+
+  inc.set_bid(1, sc.to_px(99.0), sc.to_qty(2.0));   // the 2nd bucket
+  EXPECT_TRUE(inc.dirty());
+  auto merged = inc.emit();
+  EXPECT_EQ(std::next(merged.bids.begin())->second, sc.to_qty(3.0));
+}
+
+// Cutting the engine at a depth fills the caller's FlatBook in place, and
+// reports where that depth ends.
+TEST(IncrementalConsolidatorTest, EmitsIntoAReusedFlatBook) {
+  ConsolidationCfg cfg;
+  cfg.tick = 1.0;
+  cfg.topN = 10;
+  IncrementalConsolidator inc(sc, cfg, 2);
+  for (int i = 0; i < 5; ++i) {
+    inc.set_bid(0, sc.to_px(100.0 - i), sc.to_qty(1.0));
+    inc.set_bid(1, sc.to_px(99.5 - i), sc.to_qty(1.0));
+    inc.set_ask(1, sc.to_px(101.0 + i), sc.to_qty(2.0));
+  }
+  FlatBook flat;
+  IncrementalConsolidator::Frontier f;
+  inc.emit(2, f, flat);
+  ASSERT_EQ(flat.bids.size(), 2u);
+  ASSERT_EQ(flat.asks.size(), 2u);
+  EXPECT_EQ(flat.tick, sc.to_px(1.0));
+  EXPECT_EQ(flat.bids[0].price, sc.to_px(100.0));
+  EXPECT_EQ(flat.bids[0].size, sc.to_qty(1.0));
+  EXPECT_EQ(flat.bids[1].price, sc.to_px(99.0));
+  EXPECT_EQ(flat.bids[1].size, sc.to_qty(2.0));      // 99.0 and 99.5
+  EXPECT_EQ(flat.asks[1].price, sc.to_px(102.0));
+  EXPECT_EQ(f.bid, 99);
+  EXPECT_EQ(f.ask, 102);
+
+  const auto* storage = flat.bids.data();
+  inc.emit(1, f, flat);
+  EXPECT_EQ(flat.bids.size(), 1u);
+  EXPECT_EQ(flat.bids.data(), storage);
+  inc.emit(20, f, flat);                              // shallower book than asked
+  EXPECT_EQ(flat.bids.size(), 6u);
+  EXPECT_EQ(f.bid, std::numeric_limits<px_t>::min());
+}
+
+TEST(ConsolidatorTest, FlatMergeStopsAtTopNAndReusesBuffers) {
+  ConsolidationCfg cfg;
+  cfg.tick = 1.0;
+  cfg.topN = 3;
+  OrderBook a, b;
+  for (int i = 0; i < 1000; ++i) {
+    a.bids.set(sc.to_px(1000.0 - i * 0.5), sc.to_qty(1.0));
+    b.asks.set(sc.to_px(1001.0 + i * 0.25), sc.to_qty(1.0));
+  }
+  b.bids.set(sc.to_px(999.9), sc.to_qty(2.0));
+
+  const OrderBook* books[] = {&a, &b};
+  FlatBook flat;
+  consolidate_into(books, cfg, flat);
+  ASSERT_EQ(flat.bids.size(), 3u);
+  ASSERT_EQ(flat.asks.size(), 3u);
+  EXPECT_EQ(flat.bids[0].price, sc.to_px(1000.0));
+  EXPECT_EQ(flat.bids[0].size, sc.to_qty(1.0));
+  EXPECT_EQ(flat.bids[1].price, sc.to_px(999.0));
+  EXPECT_EQ(flat.bids[1].size, sc.to_qty(4.0));      // 999.5, 999.9 (venue b), 999.0
+  EXPECT_EQ(flat.asks[0].size, sc.to_qty(1.0));      // 1001.0
+  EXPECT_EQ(flat.asks[1].price, sc.to_px(1002.0));
+  EXPECT_EQ(flat.asks[1].size, sc.to_qty(4.0));      // 1001.25 .. 1002.0
+
+  const auto* storage = flat.bids.data();
+  consolidate_into(books, cfg, flat);
+  EXPECT_EQ(flat.bids.data(), storage);
+}
+
+// A contiguous array of venue books merges the same as pointers to them, for
+// any number of venues.
+TEST(ConsolidatorTest, ContiguousBooksMatchPointerSpan) {
+  ConsolidationCfg cfg;
+  cfg.tick = 0.5;
+  cfg.topN = 4;
+  std::vector<OrderBook> books(6);
+  for (std::size_t v = 0; v < books.size(); ++v) {
+    for (int i = 0; i < 10; ++i) {
+      books[v].bids.set(sc.to_px(100.0 - 0.1 * (i + v)), sc.to_qty(1.0 + v));
+      books[v].asks.set(sc.to_px(100.5 + 0.1 * (i + v)), sc.to_qty(1.0 + v));
+    }
+  }
+  std::vector<const OrderBook*> ptrs;
+  for (const auto& ob : books) ptrs.push_back(&ob);
+
+  FlatBook by_ptr, by_value;
+  consolidate_into(ptrs, cfg, by_ptr);
+  consolidate_into(std::span<const OrderBook>(books), cfg, by_value);
+  ASSERT_EQ(by_value.bids.size(), 4u);
+  ASSERT_EQ(by_value.bids.size(), by_ptr.bids.size());
+  ASSERT_EQ(by_value.asks.size(), by_ptr.asks.size());
+  for (std::size_t i = 0; i < by_ptr.bids.size(); ++i) {
+    EXPECT_EQ(by_value.bids[i].price, by_ptr.bids[i].price);
+    EXPECT_EQ(by_value.bids[i].size, by_ptr.bids[i].size);
+    EXPECT_EQ(by_value.asks[i].price, by_ptr.asks[i].price);
+    EXPECT_EQ(by_value.asks[i].size, by_ptr.asks[i].size);
+  }
+}
@@ -0,0 +1,61 @@
+#include <gtest/gtest.h>
+#include "../common/delta_book.h"
+
+namespace {
+bookfeed::BookDelta delta(std::uint64_t seq, bool snapshot,
+                          std::initializer_list<std::pair<double, double>> bids,
+                          std::initializer_list<std::pair<double, double>> asks) {
+  bookfeed::BookDelta d;
+  d.set_seq(seq);
+  d.set_snapshot(snapshot);
+  for (auto [p, s] : bids) { auto* l = d.add_bids(); l->set_price(p); l->set_size(s); }
+  for (auto [p, s] : asks) { auto* l = d.add_asks(); l->set_price(p); l->set_size(s); }
+  return d;
+}
+}  // namespace
+
+TEST(DeltaBookTest, SnapshotThenDeltasRebuildTheBook) {
+  DeltaBook b;
+  ASSERT_TRUE(b.apply(delta(7, true, {{100.0, 1.0}, {99.0, 2.0}}, {{101.0, 1.5}})));
+  ASSERT_TRUE(b.apply(delta(8, false, {{100.5, 3.0}, {99.0, 0.0}}, {{101.0, 2.5}})));
+
+  const auto& book = b.book();
+  EXPECT_EQ(book.version(), 8u);
+  ASSERT_EQ(book.bids_size(), 2);
+  EXPECT_DOUBLE_EQ(book.bids(0).price(), 100.5);
+  EXPECT_DOUBLE_EQ(book.bids(1).price(), 100.0);
+  ASSERT_EQ(book.asks_size(), 1);
+  EXPECT_DOUBLE_EQ(book.asks(0).size(), 2.5);
+}
+
+// A skipped seq (or a delta before any snapshot) is refused and the book stays
+// out of sync until the next snapshot.
+TEST(DeltaBookTest, GapRequiresAFreshSnapshot) {
+  DeltaBook b;
+  EXPECT_FALSE(b.apply(delta(3, false, {{100.0, 1.0}}, {})));
+  ASSERT_TRUE(b.apply(delta(3, true, {{100.0, 1.0}}, {})));
+  EXPECT_FALSE(b.apply(delta(5, false, {{100.0, 2.0}}, {})));
+  EXPECT_FALSE(b.synced());
+  EXPECT_FALSE(b.apply(delta(6, false, {{100.0, 2.0}}, {})));
+
+  ASSERT_TRUE(b.apply(delta(9, true, {{98.0, 1.0}}, {})));
+  EXPECT_TRUE(b.synced());
+  ASSERT_EQ(b.book().bids_size(), 1);
+  EXPECT_DOUBLE_EQ(b.book().bids(0).price(), 98.0);
+}
+
+// A merged delta patches the book at base_seq and may skip seqs.
+TEST(DeltaBookTest, MergedDeltaPatchesItsBaseSeq) {
+  DeltaBook b;
+  ASSERT_TRUE(b.apply(delta(3, true, {{100.0, 1.0}}, {})));
+  auto merged = delta(6, false, {{100.0, 2.0}}, {});
+  merged.set_base_seq(3);
+  ASSERT_TRUE(b.apply(merged));
+  EXPECT_EQ(b.seq(), 6u);
+  EXPECT_DOUBLE_EQ(b.book().bids(0).size(), 2.0);
+
+  auto stale = delta(9, false, {{100.0, 3.0}}, {});
+  stale.set_base_seq(7);                 // the client never saw 7
+  EXPECT_FALSE(b.apply(stale));
+  EXPECT_FALSE(b.synced());
+}
@@ -0,0 +1,64 @@
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "../aggregator/json_cursor.h"
+
+// Only the values a callback reads are parsed; everything else, including
+// nested containers and strings holding brackets or escaped quotes, is
+// stepped over.
+TEST(JsonCursorTest, ReadsWantedFieldsAndSkipsTheRest) {
+  const std::string doc = R"( {"arg":{"channel":"books","instId":"BTC-USDT"},
+    "noise":[{"a":"]}","b":[1,2,{"c":"\"}"}]},null,true,false,-1.5e3],
+    "data":[{"bids":[["100.5","1.25","0","3"],["99",2]],"seqId":42}] } )";
+  JsonCursor c(doc);
+  std::string_view channel;
+  long long seq = 0;
+  std::vector<std::pair<double, double>> bids;
+  c.fields([&](std::string_view key) {
+    if (key == "arg") {
+      c.fields([&](std::string_view k) { if (k == "channel") channel = c.string(); });
+    } else if (key == "data") {
+      c.elements([&] {
+        c.fields([&](std::string_view k) {
+          if (k == "seqId") seq = c.integer();
+          if (k != "bids") return;
+          c.elements([&] {
+            double px = 0;
+            int n = 0;
+            c.elements([&] {
+              if (n == 0) px = c.number();
+              else if (n == 1) bids.emplace_back(px, c.number());
+              ++n;
+            });
+          });
+        });
+      });
+    }
+  });
+  EXPECT_EQ(channel, "books");
+  EXPECT_EQ(seq, 42);
+  ASSERT_EQ(bids.size(), 2u);
+  EXPECT_EQ(bids[0], std::make_pair(100.5, 1.25));
+  EXPECT_EQ(bids[1], std::make_pair(99.0, 2.0));
+}
+
+TEST(JsonCursorTest, ReportsValueTypes) {
+  JsonCursor c(R"([{}, [], "s", 1, true, null])");
+  std::vector<JsonCursor::Type> types;
+  c.elements([&] { types.push_back(c.type()); });
+  using T = JsonCursor::Type;
+  EXPECT_EQ(types, (std::vector<T>{T::kObject, T::kArray, T::kString, T::kNumber, T::kBool, T::kNull}));
+}
+
+TEST(JsonCursorTest, MalformedInputThrows) {
+  auto walk = [](const std::string& doc) {
+    JsonCursor c(doc);
+    c.fields([&](std::string_view) { c.number(); });
+  };
+  EXPECT_THROW(walk(R"({"a":1)"), std::runtime_error);
+  EXPECT_THROW(walk(R"({"a":"1)"), std::runtime_error);
+  EXPECT_THROW(walk(R"({"a" 1})"), std::runtime_error);
+  EXPECT_THROW(walk(R"({"a":"1x"})"), std::runtime_error);
+  EXPECT_THROW(walk(R"({"a":[1})"), std::runtime_error);
+  EXPECT_NO_THROW(walk(R"({"a":"1.5","b":-2})"));
+}
@@ -1,34 +1,194 @@
 #include <gtest/gtest.h>
+#include <random>
+#include <vector>
 #include "../common/order_book.h"
 
-TEST(OrderBookTest, ApplyDeltasBidsAddOverwriteDelete) {
-  std::map<double,double,std::greater<double>> bids;
+static const FixedScale sc{};
 
-  apply_deltas(bids, {{100.0, 1.0}, {99.5, 2.0}});
+// Both side backends must behave identically behind the OrderBook interface.
+template <class Book>
+class OrderBookTest : public ::testing::Test {};
+using Backends = ::testing::Types<MapOrderBook, LadderOrderBook>;
+TYPED_TEST_SUITE(OrderBookTest, Backends);
+
+TYPED_TEST(OrderBookTest, ApplyDeltasBidsAddOverwriteDelete) {
+  TypeParam book{sc, sc.tick_to_px(0.5)};
+  auto& bids = book.bids;
+
+  apply_deltas(bids, {{sc.to_px(100.0), sc.to_qty(1.0)}, {sc.to_px(99.5), sc.to_qty(2.0)}});
   ASSERT_EQ(bids.size(), 2u);
-  EXPECT_DOUBLE_EQ(bids.begin()->first, 100.0);
-  EXPECT_DOUBLE_EQ(bids.begin()->second, 1.0);
+  EXPECT_EQ(bids.begin()->first, sc.to_px(100.0));
+  EXPECT_EQ(bids.begin()->second, sc.to_qty(1.0));
 
-  apply_deltas(bids, {{100.0, 3.0}});
-  EXPECT_DOUBLE_EQ(bids.begin()->second, 3.0);
+  apply_deltas(bids, {{sc.to_px(100.0), sc.to_qty(3.0)}});
+  EXPECT_EQ(bids.begin()->second, sc.to_qty(3.0));
 
-  apply_deltas(bids, {{99.5, 0.0}});
+  apply_deltas(bids, {{sc.to_px(99.5), 0}});
   ASSERT_EQ(bids.size(), 1u);
-  EXPECT_DOUBLE_EQ(bids.begin()->first, 100.0);
+  EXPECT_EQ(bids.begin()->first, sc.to_px(100.0));
 }
 
-TEST(OrderBookTest, ApplyDeltasAsksAddAndDelete) {
-  std::map<double,double,std::less<double>> asks;
+// diff_levels(before, after) applied to a copy of before yields after.
+TYPED_TEST(OrderBookTest, DiffLevelsReplaysIntoTarget) {
+  TypeParam before{sc, sc.tick_to_px(0.5)}, after{sc, sc.tick_to_px(0.5)};
+  apply_deltas(before.asks, {{sc.to_px(100.0), sc.to_qty(1.0)}, {sc.to_px(100.5), sc.to_qty(2.0)},
+                             {sc.to_px(101.0), sc.to_qty(3.0)}});
+  apply_deltas(after.asks, {{sc.to_px(99.5), sc.to_qty(4.0)}, {sc.to_px(100.5), sc.to_qty(2.0)},
+                            {sc.to_px(101.0), sc.to_qty(5.0)}, {sc.to_px(102.0), sc.to_qty(1.0)}});
 
-  apply_deltas(asks, {{100.5, 1.0}, {101.0, 2.0}});
+  std::vector<Delta> d;
+  diff_levels(before.asks, after.asks, [&](px_t p, qty_t q) { d.push_back({p, q}); });
+  const std::vector<Delta> want{{sc.to_px(99.5), sc.to_qty(4.0)}, {sc.to_px(100.0), 0},
+                                {sc.to_px(101.0), sc.to_qty(5.0)}, {sc.to_px(102.0), sc.to_qty(1.0)}};
+  EXPECT_EQ(d, want);   // unchanged 100.5 is left out
+
+  apply_deltas(before.asks, std::span<const Delta>(d));
+  ASSERT_EQ(before.asks.size(), after.asks.size());
+  for (auto b = before.asks.begin(), a = after.asks.begin(); a != after.asks.end(); ++a, ++b) {
+    EXPECT_EQ(b->first, a->first);
+    EXPECT_EQ(b->second, a->second);
+  }
+}
+
+TYPED_TEST(OrderBookTest, ApplyDeltasAsksAddAndDelete) {
+  TypeParam book{sc, sc.tick_to_px(0.5)};
+  auto& asks = book.asks;
+
+  apply_deltas(asks, {{sc.to_px(100.5), sc.to_qty(1.0)}, {sc.to_px(101.0), sc.to_qty(2.0)}});
   ASSERT_EQ(asks.size(), 2u);
-  EXPECT_DOUBLE_EQ(asks.begin()->first, 100.5);
-  EXPECT_DOUBLE_EQ(asks.begin()->second, 1.0);
-  
-  apply_deltas(asks, {{100.5, 3.0}});
-  EXPECT_DOUBLE_EQ(asks.begin()->second, 3.0);
+  EXPECT_EQ(asks.begin()->first, sc.to_px(100.5));
+  EXPECT_EQ(asks.begin()->second, sc.to_qty(1.0));
+
+  apply_deltas(asks, {{sc.to_px(100.5), sc.to_qty(3.0)}});
+  EXPECT_EQ(asks.begin()->second, sc.to_qty(3.0));
 
-  apply_deltas(asks, {{100.5, 0.0}});
+  apply_deltas(asks, {{sc.to_px(100.5), 0}});
   ASSERT_EQ(asks.size(), 1u);
-  EXPECT_DOUBLE_EQ(asks.begin()->first, 101.0);
+  EXPECT_EQ(asks.begin()->first, sc.to_px(101.0));
+}
+
+// Counts upstream allocations made by a pool once it is warm.
+struct CountingResource : std::pmr::memory_resource {
+  std::size_t allocs = 0;
+  void* do_allocate(std::size_t n, std::size_t a) override {
+    ++allocs; return std::pmr::new_delete_resource()->allocate(n, a);
+  }
+  void do_deallocate(void* p, std::size_t n, std::size_t a) override {
+    std::pmr::new_delete_resource()->deallocate(p, n, a);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+};
+
+TYPED_TEST(OrderBookTest, PooledBookChurnDoesNotReachUpstream) {
+  CountingResource upstream;
+  std::pmr::unsynchronized_pool_resource pool{&upstream};
+  TypeParam book{sc, 1, &pool};
+
+  for (px_t p = 0; p < 512; ++p) book.bids.set(1000 + p, 1);   // warm-up
+  const std::size_t warm = upstream.allocs;
+  for (int round = 0; round < 100; ++round) {
+    for (px_t p = 0; p < 512; ++p) book.bids.set(1000 + p, (p + round) % 2);
+    for (px_t p = 0; p < 512; ++p) book.bids.set(1000 + p, 1);
+  }
+  EXPECT_EQ(upstream.allocs, warm);
+}
+
+TEST(OrderBookTest, FixedScaleRoundTripsVenueDecimals) {
+  EXPECT_EQ(sc.to_px(110110.82), 11011082000000LL);
+  EXPECT_EQ(sc.to_qty(0.00000001), 1);
+  EXPECT_DOUBLE_EQ(sc.px_to_double(sc.to_px(110110.82)), 110110.82);
+  EXPECT_EQ(floor_div(-7, 2), -4);
+  EXPECT_EQ(ceil_div(7, 2), 4);
+  EXPECT_THROW(sc.tick_to_px(1e-9), std::invalid_argument);
+}
+
+// Walks the window far in both directions and mixes in off-grid prices; the
+// ladder must keep the exact contents and ordering of the map backend.
+TEST(LadderTest, MatchesMapUnderRandomWalk) {
+  const px_t tick = 10;
+  LadderLevels<std::greater<px_t>> lb(tick, 256);
+  LadderLevels<std::less<px_t>> la(tick, 256);
+  MapLevels<std::greater<px_t>> mb;
+  MapLevels<std::less<px_t>> ma;
+
+  std::mt19937_64 rng(7);
+  px_t mid = 1'000'000;
+  for (int i = 0; i < 20000; ++i) {
+    if (i % 500 == 0) mid += static_cast<px_t>(rng() % 8001) - 4000;
+    const px_t off = static_cast<px_t>(rng() % 3000);
+    px_t p = mid + (rng() % 2 ? off : -off);
+    if (rng() % 10 != 0) p -= p % tick;   // mostly on-grid
+    const qty_t q = rng() % 3 == 0 ? 0 : static_cast<qty_t>(rng() % 100 + 1);
+    lb.set(p, q); mb.set(p, q);
+    la.set(p, q); ma.set(p, q);
+
+    if (i % 97 == 0) {
+      ASSERT_EQ(lb.size(), mb.size());
+      ASSERT_EQ(la.size(), ma.size());
+      ASSERT_TRUE(std::equal(lb.begin(), lb.end(), mb.begin(), mb.end(),
+                             [](auto a, auto b) { return a.first == b.first && a.second == b.second; }));
+      ASSERT_TRUE(std::equal(la.begin(), la.end(), ma.begin(), ma.end(),
+                             [](auto a, auto b) { return a.first == b.first && a.second == b.second; }));
+      ASSERT_EQ(lb.get(p), mb.get(p));
+    }
+  }
+  lb.clear();
+  EXPECT_TRUE(lb.empty());
+  EXPECT_TRUE(lb.begin() == lb.end());
+}
+
+TEST(LadderTest, BestTracksDeletesAndRecentres) {
+  LadderLevels<std::less<px_t>> asks(1, 64);
+  asks.set(1000, 5);
+  asks.set(1010, 6);
+  asks.set(5000, 7);                    // beyond the window -> overflow
+  EXPECT_EQ(asks.overflow_size(), 1u);
+  EXPECT_EQ(asks.begin()->first, 1000);
+
+  asks.set(1000, 0);
+  EXPECT_EQ(asks.begin()->first, 1010);
+  asks.set(1010, 0);                    // window empty; best comes from overflow
+  EXPECT_EQ(asks.begin()->first, 5000);
+
+  asks.set(4990, 1);                    // window follows the book and pulls 5000 back in
+  EXPECT_EQ(asks.overflow_size(), 0u);
+  EXPECT_EQ(asks.begin()->first, 4990);
+  EXPECT_EQ(std::next(asks.begin())->first, 5000);
+}
+
+TYPED_TEST(OrderBookTest, TracksBboAndTouchedPrices) {
+  TypeParam book{sc, 1};
+  for (px_t i = 0; i < 10; ++i) { book.bids.set(100 - i, 1); book.asks.set(101 + i, 1); }
+  auto ch = book.take_changes();
+  EXPECT_TRUE(ch.bbo_changed);
+  EXPECT_EQ(book.bbo().bid_px, 100);
+  EXPECT_EQ(book.bbo().ask_px, 101);
+
+  book.bids.set(92, 5);                        // 9th bid level
+  ch = book.take_changes();
+  EXPECT_FALSE(ch.bbo_changed);
+  EXPECT_TRUE(ch.any());
+  EXPECT_TRUE(ch.bid_touched);
+  EXPECT_FALSE(ch.ask_touched);
+  EXPECT_EQ(ch.bid_px, 92);
+
+  book.asks.set(103, 0);                       // deletes count as touches
+  book.asks.set(102, 0);
+  ch = book.take_changes();
+  EXPECT_FALSE(ch.bbo_changed);
+  EXPECT_EQ(ch.ask_px, 102);                   // the most aggressive one
+
+  book.asks.set(101, 7);                       // resize at the touch
+  ch = book.take_changes();
+  EXPECT_TRUE(ch.bbo_changed);
+  EXPECT_EQ(book.bbo().ask_sz, 7);
+
+  ch = book.take_changes();
+  EXPECT_FALSE(ch.any());
+  EXPECT_FALSE(ch.bbo_changed);
+
+  book.bids.clear();
+  ch = book.take_changes();
+  EXPECT_TRUE(ch.bid_cleared);
+  EXPECT_FALSE(book.bbo().has_bid);
 }
@@ -0,0 +1,79 @@
+#include <gtest/gtest.h>
+#include "../common/packed_book.h"
+
+static const FixedScale sc{8, 8};
+
+namespace {
+OrderBook sample(px_t tick, int depth) {
+  OrderBook b{sc, tick};
+  for (int i = 0; i < depth; ++i) {
+    b.bids.set(sc.to_px(100000.0) - i * tick, sc.to_qty(0.125 * (i + 1)));
+    b.asks.set(sc.to_px(100000.1) + 3 * i * tick, sc.to_qty(1.5 + i));
+  }
+  return b;
+}
+}  // namespace
+
+TEST(PackedBookTest, RoundTripsLevelsExactly) {
+  const px_t tick = sc.tick_to_px(0.1);
+  const OrderBook b = sample(tick, 50);
+
+  bookfeed::ConsolidatedBook msg;
+  pack_levels(b, tick, msg);
+  ASSERT_EQ(msg.bid_px_size(), 50);
+  EXPECT_EQ(msg.bid_px(1), -1);   // one tick below the best bid
+  EXPECT_EQ(msg.ask_px(1), 3);
+
+  bookfeed::ConsolidatedBook wire;
+  ASSERT_TRUE(wire.ParseFromString(msg.SerializeAsString()));
+  FlatBook out;
+  ASSERT_TRUE(unpack_levels(wire, out));
+  EXPECT_EQ(out.scale, sc);
+  ASSERT_EQ(out.bids.size(), 50u);
+  ASSERT_EQ(out.asks.size(), 50u);
+  auto bid = b.bids.begin();
+  for (const auto& l : out.bids) {
+    EXPECT_EQ(l.price, bid->first);
+    EXPECT_EQ(l.size, bid->second);
+    ++bid;
+  }
+  auto ask = b.asks.begin();
+  for (const auto& l : out.asks) {
+    EXPECT_EQ(l.price, ask->first);
+    EXPECT_EQ(l.size, ask->second);
+    ++ask;
+  }
+
+  // Decoding again reuses the buffers.
+  const auto* storage = out.bids.data();
+  ASSERT_TRUE(unpack_levels(wire, out));
+  EXPECT_EQ(out.bids.data(), storage);
+}
+
+// 200 levels a side: the packed form must be well under half the Level form.
+TEST(PackedBookTest, SmallerThanLevelMessages) {
+  const px_t tick = sc.tick_to_px(0.1);
+  const OrderBook b = sample(tick, 200);
+
+  bookfeed::ConsolidatedBook levels, packed;
+  for (const auto& [p, s] : b.bids) {
+    auto* l = levels.add_bids(); l->set_price(sc.px_to_double(p)); l->set_size(sc.qty_to_double(s));
+  }
+  for (const auto& [p, s] : b.asks) {
+    auto* l = levels.add_asks(); l->set_price(sc.px_to_double(p)); l->set_size(sc.qty_to_double(s));
+  }
+  pack_levels(b, tick, packed);
+  EXPECT_LT(packed.ByteSizeLong() * 2, levels.ByteSizeLong());
+}
+
+TEST(PackedBookTest, RejectsMismatchedArrays) {
+  bookfeed::ConsolidatedBook msg;
+  msg.set_px_tick(10);
+  msg.add_bid_px(5);
+  FlatBook out;
+  EXPECT_FALSE(unpack_levels(msg, out));
+  msg.add_bid_qty(1);
+  EXPECT_TRUE(unpack_levels(msg, out));
+  msg.set_px_tick(0);
+  EXPECT_FALSE(unpack_levels(msg, out));
+}
@@ -0,0 +1,73 @@
+#include <gtest/gtest.h>
+#include <string>
+#include "../common/fixed_point.h"
+
+namespace {
+std::int64_t parsed(std::string_view s, int dp) {
+  std::int64_t v = 0;
+  EXPECT_TRUE(parse_fixed(s, dp, v)) << s;
+  return v;
+}
+bool rejects(std::string_view s, int dp = 8) {
+  std::int64_t v = 0;
+  return !parse_fixed(s, dp, v);
+}
+}  // namespace
+
+TEST(ParseFixedTest, DecimalStringsAreExact) {
+  EXPECT_EQ(parsed("110000.01", 8), 11000001000000LL);
+  EXPECT_EQ(parsed("0.00100000", 8), 100000);
+  EXPECT_EQ(parsed("7", 8), 700000000);
+  EXPECT_EQ(parsed("7.", 2), 700);
+  EXPECT_EQ(parsed(".5", 2), 50);
+  EXPECT_EQ(parsed("-12.345", 3), -12345);
+  EXPECT_EQ(parsed("+1.25", 2), 125);
+  EXPECT_EQ(parsed("0", 8), 0);
+  // Long digit runs take the 8-at-a-time path.
+  EXPECT_EQ(parsed("1234567890.12345678", 8), 123456789012345678LL);
+}
+
+// Digits beyond dp round half away from zero, like to_fixed().
+TEST(ParseFixedTest, ExtraDigitsRoundLikeToFixed) {
+  EXPECT_EQ(parsed("1.005", 2), 101);
+  EXPECT_EQ(parsed("1.00499999", 2), 100);
+  EXPECT_EQ(parsed("-1.005", 2), -101);
+  EXPECT_EQ(parsed("0.123456789", 8), 12345679);
+  for (const char* s : {"100.5", "99.25", "0.00012345", "68123.4", "3.14159265"})
+    EXPECT_EQ(parsed(s, 8), to_fixed(std::stod(s), 8)) << s;
+}
+
+TEST(ParseFixedTest, ExponentFormsAreAccepted) {
+  EXPECT_EQ(parsed("1.5e-05", 8), 1500);
+  EXPECT_EQ(parsed("2E3", 2), 200000);
+}
+
+TEST(ParseFixedTest, RejectsNonNumbersAndOverflow) {
+  EXPECT_TRUE(rejects(""));
+  EXPECT_TRUE(rejects("-"));
+  EXPECT_TRUE(rejects("."));
+  EXPECT_TRUE(rejects("abc"));
+  EXPECT_TRUE(rejects("1.2.3"));
+  EXPECT_TRUE(rejects("12a"));
+  EXPECT_TRUE(rejects(" 1"));
+  EXPECT_TRUE(rejects("12345678901", 8));   // 19 significant digits at dp 8
+  EXPECT_TRUE(rejects("1e300"));
+  EXPECT_THROW(FixedScale{}.parse_px("n/a"), std::invalid_argument);
+  EXPECT_EQ(FixedScale{}.parse_qty("2.5"), 250000000);
+}
+
+TEST(FormatFixedTest, ShortestDecimalRoundTrips) {
+  auto text = [](std::int64_t v, int dp) {
+    char buf[24];
+    return std::string(buf, format_fixed(v, dp, buf));
+  };
+  EXPECT_EQ(text(4100680000000LL, 8), "41006.8");
+  EXPECT_EQ(text(700000000, 8), "7");
+  EXPECT_EQ(text(10000, 8), "0.0001");
+  EXPECT_EQ(text(60038921, 8), "0.60038921");
+  EXPECT_EQ(text(0, 8), "0");
+  EXPECT_EQ(text(-12345, 3), "-12.345");
+  EXPECT_EQ(text(123456789012345678LL, 8), "1234567890.12345678");
+  for (std::int64_t v : {1LL, 99LL, 100000LL, 31415926535LL, -250LL})
+    EXPECT_EQ(parsed(text(v, 8), 8), v);
+}
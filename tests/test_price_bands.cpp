@@ -58,3 +58,19 @@ TEST(PriceBandsTest, LimitInclusiveSemantics_Bids) {
   EXPECT_NEAR(vwap, exp_vwap, 1e-9);
   EXPECT_NEAR(qty, exp_qty, 1e-9);
 }
+
+// Fixed-point overloads: same walk as above, exact integer accumulation.
+TEST(PriceBandsTest, FixedPointMatchesDoubleVWAP) {
+  const FixedScale sc{};
+  const std::vector<LevelPxSz> bids = {
+    {sc.to_px(100.9), sc.to_qty(1.0)}, {sc.to_px(100.5), sc.to_qty(2.0)}, {sc.to_px(100.0), sc.to_qty(3.0)}};
+  const std::vector<LevelPxSz> asks = {
+    {sc.to_px(101.0), sc.to_qty(3.0)}, {sc.to_px(101.5), sc.to_qty(4.0)}};
+
+  qty_t qty = 0;
+  EXPECT_NEAR(vwap_bids_to_price(bids, sc, sc.to_px(100.5), &qty), 100.63333333333333, 1e-9);
+  EXPECT_EQ(qty, sc.to_qty(3.0));
+
+  EXPECT_NEAR(vwap_asks_to_price(asks, sc, sc.to_px(101.5), &qty), (101.0 * 3.0 + 101.5 * 4.0) / 7.0, 1e-9);
+  EXPECT_EQ(qty, sc.to_qty(7.0));
+}
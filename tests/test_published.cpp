@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../common/published.h"
+#include "../common/order_book.h"
+
+// Every version the writer publishes has all elements equal; a reader must
+// never observe a mix of two versions, and versions must only move forward.
+TEST(PublishedTest, ReadersSeeWholeVersionsWhileWriterPublishes) {
+  Published<std::vector<int>> cell{std::vector<int>(256, 0)};
+  std::atomic<bool> done{false};
+  std::atomic<int> torn{0}, backwards{0};
+
+  std::vector<std::thread> readers;
+  for (int r = 0; r < 3; ++r) {
+    readers.emplace_back([&] {
+      int last = 0;
+      while (!done.load()) {
+        auto v = cell.load();
+        const int first = v->front();
+        for (int x : *v) if (x != first) { ++torn; break; }
+        if (first < last) ++backwards;
+        last = first;
+      }
+    });
+  }
+  for (int ver = 1; ver <= 20000; ++ver) cell.publish(std::vector<int>(256, ver));
+  done = true;
+  for (auto& t : readers) t.join();
+
+  EXPECT_EQ(torn.load(), 0);
+  EXPECT_EQ(backwards.load(), 0);
+  EXPECT_EQ(cell.load()->front(), 20000);
+}
+
+TEST(PublishedTest, HeldVersionStaysUnchangedAcrossPublishes) {
+  const FixedScale sc{};
+  OrderBook book{sc};
+  book.bids.set(sc.to_px(100.0), sc.to_qty(1.0));
+  Published<OrderBook> cell{book};
+
+  auto held = cell.load();
+  book.bids.set(sc.to_px(100.0), sc.to_qty(2.0));
+  cell.publish(book);
+  cell.publish(book);   // retired version is still held -> must not be recycled
+  book.bids.set(sc.to_px(100.0), sc.to_qty(3.0));
+  cell.publish(book);
+
+  EXPECT_EQ(held->bids.get(sc.to_px(100.0)), sc.to_qty(1.0));
+  EXPECT_EQ(cell.load()->bids.get(sc.to_px(100.0)), sc.to_qty(3.0));
+}
+
+TEST(PublishedTest, UpdateFillsRecycledStorageInPlace) {
+  Published<std::vector<int>> cell;
+  cell.update([](std::vector<int>& v) { v.assign(4, 1); });
+  cell.update([](std::vector<int>& v) { v.assign(4, 2); });
+  const std::vector<int>* two = cell.load().get();
+
+  // With no reader holding on, the writer alternates between two versions.
+  cell.update([](std::vector<int>& v) { v.assign(4, 3); });
+  cell.update([](std::vector<int>& v) { v.assign(4, 4); });
+  EXPECT_EQ(cell.load().get(), two);
+  EXPECT_EQ(*cell.load(), std::vector<int>(4, 4));
+}
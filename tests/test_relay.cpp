@@ -0,0 +1,239 @@
+#include <gtest/gtest.h>
+#include <grpcpp/grpcpp.h>
+#include "bookfeed.grpc.pb.h"
+
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "../common/packed_book.h"
+#include "../aggregator/symbol_pipeline.h"
+#include "../aggregator/upstream_adapter.h"
+
+// Relay mode across processes: each upstream aggregator is a child process
+// (this binary re-run with --upstream), serving one fixed book on
+// StreamBook; the relay side is an UpstreamAdapter, or a SymbolPipeline
+// around one, in the test process.
+
+extern char** environ;
+
+namespace {
+const FixedScale kScale{2, 4};
+constexpr double kTick = 0.5;
+constexpr px_t kTickPx = 50;
+
+class FakeUpstream final : public bookfeed::BookFeed::Service {
+public:
+  explicit FakeUpstream(px_t bid) : bid_(bid) {}
+
+  grpc::Status StreamBook(grpc::ServerContext* ctx, const bookfeed::SubscribeRequest* req,
+                          grpc::ServerWriter<bookfeed::ConsolidatedBook>* w) override {
+    if (req->depth() != UpstreamAdapter::kDepth || req->tick() != kTick)
+      return grpc::Status(grpc::StatusCode::INVALID_ARGUMENT, "relay must ask for the full depth");
+    OrderBook book{kScale, kTickPx};
+    book.bids.set(bid_, 10000);
+    book.asks.set(bid_ + kTickPx, 20000);
+    bookfeed::ConsolidatedBook msg;
+    msg.set_version(1);
+    pack_levels(book, kTickPx, msg);
+    if (!w->Write(msg)) return grpc::Status::OK;
+    while (!ctx->IsCancelled()) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return grpc::Status::OK;
+  }
+
+private:
+  const px_t bid_;
+};
+
+// Child process: serve on port (0 = any) and report the bound port on stdout.
+int run_upstream(int port, px_t bid) {
+  FakeUpstream svc(bid);
+  grpc::ServerBuilder builder;
+  int bound = 0;
+  builder.AddListeningPort("127.0.0.1:" + std::to_string(port), grpc::InsecureServerCredentials(), &bound);
+  builder.RegisterService(&svc);
+  builder.AddChannelArgument(GRPC_ARG_HTTP2_MIN_RECV_PING_INTERVAL_WITHOUT_DATA_MS, 50);
+  builder.AddChannelArgument(GRPC_ARG_KEEPALIVE_PERMIT_WITHOUT_CALLS, 1);
+  auto server = builder.BuildAndStart();
+  if (!server) return 1;
+  std::printf("%d\n", bound);
+  std::fflush(stdout);
+  server->Wait();
+  return 0;
+}
+
+// Parent side handle on one upstream process; killed when it goes out of scope.
+class Upstream {
+public:
+  Upstream(int port, px_t bid) {
+    int fds[2];
+    if (::pipe(fds) != 0) throw std::runtime_error("pipe");
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_adddup2(&fa, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&fa, fds[0]);
+    const std::string p = std::to_string(port), b = std::to_string(bid);
+    char* argv[] = {const_cast<char*>("relay_test"), const_cast<char*>("--upstream"),
+                    const_cast<char*>(p.c_str()), const_cast<char*>(b.c_str()), nullptr};
+    const int rc = posix_spawn(&pid_, "/proc/self/exe", &fa, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    ::close(fds[1]);
+    if (rc != 0) {
+      ::close(fds[0]);
+      throw std::runtime_error("posix_spawn");
+    }
+    FILE* out = ::fdopen(fds[0], "r");
+    if (std::fscanf(out, "%d", &port_) != 1) port_ = 0;
+    std::fclose(out);
+  }
+  ~Upstream() { kill(SIGKILL); }
+
+  int port() const { return port_; }
+  std::string endpoint() const { return "127.0.0.1:" + std::to_string(port_); }
+
+  void signal(int sig) { if (pid_ > 0) ::kill(pid_, sig); }
+  void kill(int sig) {
+    if (pid_ <= 0) return;
+    ::kill(pid_, sig);
+    ::waitpid(pid_, nullptr, 0);
+    pid_ = -1;
+  }
+
+private:
+  pid_t pid_{-1};
+  int port_{0};
+};
+
+// What the relay side has been handed: the best bid of the last book, or
+// nothing for an empty book.
+class Seen {
+public:
+  void on_book(const OrderBook& book) {
+    std::lock_guard<std::mutex> lk(mu_);
+    bid_ = book.bids.empty() ? std::nullopt : std::optional<px_t>(book.bids.begin()->first);
+    ++books_;
+    cv_.notify_all();
+  }
+  // Wait up to 10 s for the best bid to become want (nullopt: an empty book).
+  bool wait_bid(std::optional<px_t> want) {
+    std::unique_lock<std::mutex> lk(mu_);
+    return cv_.wait_for(lk, std::chrono::seconds(10), [&] { return books_ > 0 && bid_ == want; });
+  }
+
+private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::optional<px_t> bid_;
+  int books_{0};
+};
+}  // namespace
+
+// The upstream process dies: the relay drops its copy of the book at once,
+// then picks up the restarted upstream's book on the same address.
+TEST(RelayTest, ClearsBookAndReconnectsAfterUpstreamRestart) {
+  auto first = std::make_unique<Upstream>(0, 10000);
+  ASSERT_GT(first->port(), 0);
+  const int port = first->port();
+
+  Seen seen;
+  UpstreamAdapter relay(first->endpoint(), "BTCUSDT", kScale, kTick, std::chrono::milliseconds(200));
+  relay.start([&](const OrderBook& book, VenueId) { seen.on_book(book); });
+  ASSERT_TRUE(seen.wait_bid(10000));
+
+  first->kill(SIGKILL);
+  EXPECT_TRUE(seen.wait_bid(std::nullopt));
+
+  Upstream second(port, 10050);
+  ASSERT_EQ(second.port(), port);
+  EXPECT_TRUE(seen.wait_bid(10050));
+  EXPECT_GE(relay.connects(), 2u);
+  relay.stop();
+}
+
+// The upstream process hangs with its connection open: keepalive notices,
+// the relay stops serving the stale book, and recovers once it answers again.
+TEST(RelayTest, DropsStaleUpstreamUntilItAnswersAgain) {
+  Upstream up(0, 10000);
+  ASSERT_GT(up.port(), 0);
+
+  Seen seen;
+  UpstreamAdapter relay(up.endpoint(), "BTCUSDT", kScale, kTick, std::chrono::milliseconds(200));
+  relay.start([&](const OrderBook& book, VenueId) { seen.on_book(book); });
+  ASSERT_TRUE(seen.wait_bid(10000));
+
+  up.signal(SIGSTOP);
+  EXPECT_TRUE(seen.wait_bid(std::nullopt));
+
+  up.signal(SIGCONT);
+  EXPECT_TRUE(seen.wait_bid(10000));
+  relay.stop();
+}
+
+// stop() returns promptly even while the stream is blocked on a quiet book.
+TEST(RelayTest, StopInterruptsAnIdleStream) {
+  Upstream up(0, 10000);
+  Seen seen;
+  UpstreamAdapter relay(up.endpoint(), "BTCUSDT", kScale, kTick);
+  relay.start([&](const OrderBook& book, VenueId) { seen.on_book(book); });
+  ASSERT_TRUE(seen.wait_bid(10000));
+
+  const auto t0 = std::chrono::steady_clock::now();
+  relay.stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - t0, std::chrono::seconds(2));
+}
+
+// The relay's own subscribers: views at multiples of the upstream tick are
+// filled from the upstream book, and ticks or depths it cannot fill are
+// refused up front.
+TEST(RelayTest, ServesDownstreamViewsItCanFill) {
+  Upstream up(0, 10000);
+  ASSERT_GT(up.port(), 0);
+  SymbolSpec spec{"BTCUSDT", {{VenueKind::kUpstream, "BTCUSDT", kTick, up.endpoint()}}, kScale, {kTick, 10}};
+  SymbolPipeline p(spec, AdapterBase::Conflation{});
+
+  EXPECT_THROW(p.subscribe({0.75, 5}), std::invalid_argument);   // straddles upstream buckets
+  EXPECT_THROW(p.subscribe({0.25, 5}), std::invalid_argument);   // finer than the upstream
+  EXPECT_THROW(p.subscribe({1.0, 501}), std::invalid_argument);  // needs 1002 upstream levels
+  auto deepest = p.subscribe({1.0, 500});
+  ASSERT_TRUE(deepest);
+  p.release(*deepest);
+
+  auto fine = p.subscribe({0.0, 0});
+  auto coarse = p.subscribe({1.0, 5});
+  ASSERT_TRUE(fine && coarse);
+  p.start();
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while ((coarse->book().bids.empty() || fine->book().asks.empty())
+         && std::chrono::steady_clock::now() < deadline) {
+    if (!p.poll()) std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  p.stop();
+
+  ASSERT_FALSE(fine->book().bids.empty());
+  ASSERT_FALSE(fine->book().asks.empty());
+  EXPECT_EQ(fine->book().bids.front().price, 10000);
+  EXPECT_EQ(fine->book().asks.front().price, 10050);
+  ASSERT_FALSE(coarse->book().bids.empty());
+  ASSERT_FALSE(coarse->book().asks.empty());
+  EXPECT_EQ(coarse->book().bids.front().price, 10000);
+  EXPECT_EQ(coarse->book().asks.front().price, 10100);
+  EXPECT_EQ(coarse->book().asks.front().size, 20000);
+  p.release(*coarse);
+  p.release(*fine);
+}
+
+int main(int argc, char** argv) {
+  if (argc == 4 && std::string(argv[1]) == "--upstream")
+    return run_upstream(std::atoi(argv[2]), std::atoll(argv[3]));
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "../aggregator/shard_pool.h"
+
+// Pollers are spread round-robin and each one only ever runs on its shard's
+// thread, so per-symbol state behind a poller needs no locking.
+TEST(ShardPoolTest, EachPollerStaysOnItsShardThread) {
+  constexpr int kPollers = 7;
+  ShardPool pool(3);
+  struct Seen {
+    std::atomic<int> calls{0};
+    std::atomic<bool> moved{false};
+    std::thread::id first{};
+  };
+  std::vector<Seen> seen(kPollers);
+  std::vector<std::size_t> shard_of;
+
+  for (int i = 0; i < kPollers; ++i) {
+    shard_of.push_back(pool.add([&s = seen[i]] {
+      if (s.calls++ == 0) s.first = std::this_thread::get_id();
+      else if (s.first != std::this_thread::get_id()) s.moved = true;
+      return s.calls < 1000;
+    }));
+  }
+  EXPECT_EQ(shard_of, (std::vector<std::size_t>{0, 1, 2, 0, 1, 2, 0}));
+
+  pool.start();
+  auto all_done = [&] {
+    for (const Seen& s : seen)
+      if (s.calls < 1000) return false;
+    return true;
+  };
+  for (int i = 0; i < 400 && !all_done(); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  pool.stop();
+
+  for (int i = 0; i < kPollers; ++i) {
+    EXPECT_GE(seen[i].calls.load(), 1000);
+    EXPECT_FALSE(seen[i].moved.load());
+  }
+  EXPECT_EQ(seen[0].first, seen[3].first);
+  EXPECT_NE(seen[0].first, seen[1].first);
+}
@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include "../common/shm_book.h"
+
+static const FixedScale sc{8, 8};
+
+static std::string segment(const char* tag) {
+  return "/agg-test-" + std::string(tag) + "-" + std::to_string(::getpid());
+}
+
+TEST(ShmBookTest, ReaderSeesLatestBookInPlace) {
+  const std::string name = segment("latest");
+  ShmBookWriter w(name, "BTCUSDT", sc, 4);
+  ShmBookReader r(name);
+  EXPECT_EQ(r.symbol(), "BTCUSDT");
+  EXPECT_EQ(r.scale(), sc);
+  EXPECT_EQ(r.depth(), 4u);
+  EXPECT_FALSE(r.read_latest([](const ShmBookView&) {}));
+
+  OrderBook b{sc};
+  for (int i = 0; i < 6; ++i) {
+    b.bids.set(sc.to_px(100.0 - i), sc.to_qty(1.0 + i));
+    b.asks.set(sc.to_px(101.0 + i), sc.to_qty(2.0 + i));
+  }
+  b.asks.set(sc.to_px(101.0), 0);
+  w.write(7, 1234, b);
+
+  ShmLevel best_bid{}, best_ask{};
+  std::size_t n_bids = 0, n_asks = 0;
+  std::uint64_t version = 0;
+  ASSERT_TRUE(r.read_latest([&](const ShmBookView& v) {
+    version = v.version;
+    n_bids = v.bids.size();
+    n_asks = v.asks.size();
+    best_bid = v.bids[0];
+    best_ask = v.asks[0];
+  }));
+  EXPECT_EQ(version, 7u);
+  EXPECT_EQ(n_bids, 4u);   // capped at depth
+  EXPECT_EQ(n_asks, 4u);
+  EXPECT_EQ(best_bid.px, sc.to_px(100.0));
+  EXPECT_EQ(best_ask.px, sc.to_px(102.0));
+  EXPECT_EQ(best_ask.qty, sc.to_qty(3.0));
+}
+
+// Each book the writer puts out has every size equal to its version; a reader
+// racing it must only ever accept uniform books, with versions moving forward.
+TEST(ShmBookTest, ConcurrentReaderNeverAcceptsATornBook) {
+  const std::string name = segment("torn");
+  ShmBookWriter w(name, "X", sc, 64, 2);
+  ShmBookReader r(name);
+  std::atomic<bool> done{false};
+
+  std::thread writer([&] {
+    OrderBook b{sc};
+    for (std::uint64_t v = 1; v <= 20000; ++v) {
+      for (int i = 0; i < 64; ++i) {
+        b.bids.set(sc.to_px(100.0) - i, static_cast<qty_t>(v));
+        b.asks.set(sc.to_px(101.0) + i, static_cast<qty_t>(v));
+      }
+      w.write(v, 0, b);
+    }
+    done = true;
+  });
+
+  int torn = 0, backwards = 0;
+  std::uint64_t last = 0;
+  while (!done.load()) {
+    std::uint64_t version = 0;
+    bool uniform = true;
+    if (!r.read_latest([&](const ShmBookView& v) {
+          version = v.version;
+          uniform = v.bids.size() == 64 && v.asks.size() == 64;
+          for (const auto& l : v.bids) uniform &= static_cast<std::uint64_t>(l.qty) == v.version;
+          for (const auto& l : v.asks) uniform &= static_cast<std::uint64_t>(l.qty) == v.version;
+        }))
+      continue;
+    if (!uniform) ++torn;
+    if (version < last) ++backwards;
+    last = version;
+  }
+  writer.join();
+  EXPECT_EQ(torn, 0);
+  EXPECT_EQ(backwards, 0);
+}
+
+TEST(ShmBookTest, RejectsMissingOrForeignSegments) {
+  EXPECT_THROW(ShmBookReader(segment("missing")), std::system_error);
+}
+
+TEST(ShmBookTest, ReaderNoticesAWriterRestart) {
+  const std::string name = segment("restart");
+  OrderBook b{sc};
+  b.bids.set(sc.to_px(100.0), sc.to_qty(1.0));
+
+  // Clean shutdown: the old mapping is marked closed.
+  auto first = std::make_unique<ShmBookWriter>(name, "X", sc, 1);
+  ShmBookReader r1(name);
+  EXPECT_FALSE(r1.closed());
+  EXPECT_FALSE(r1.replaced());
+  first.reset();
+  EXPECT_TRUE(r1.closed());
+  EXPECT_TRUE(r1.replaced());
+
+  // A writer that never closed (as after a crash) is replaced under the same
+  // name; only the inode tells.
+  ShmBookWriter second(name, "X", sc, 1);
+  ShmBookReader r2(name);
+  ShmBookWriter third(name, "X", sc, 1);
+  EXPECT_FALSE(r2.closed());
+  EXPECT_TRUE(r2.replaced());
+
+  ShmBookReader r3(name);
+  EXPECT_FALSE(r3.replaced());
+  third.write(1, 0, b);
+  EXPECT_EQ(r3.written(), 1u);
+  EXPECT_EQ(r2.written(), 0u);
+}
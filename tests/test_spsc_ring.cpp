@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "../common/spsc_ring.h"
+
+TEST(SpscRingTest, WrapsAroundAndRejectsWhenFull) {
+  SpscRing<int> ring(3);                 // rounded up to 4
+  ASSERT_EQ(ring.capacity(), 4u);
+
+  int out = 0;
+  for (int round = 0; round < 10; ++round) {
+    for (int i = 0; i < 4; ++i) ASSERT_TRUE(ring.try_push(round * 4 + i));
+    EXPECT_FALSE(ring.try_push(-1));
+    for (int i = 0; i < 4; ++i) {
+      ASSERT_TRUE(ring.try_pop(out));
+      EXPECT_EQ(out, round * 4 + i);
+    }
+    EXPECT_FALSE(ring.try_pop(out));
+  }
+}
+
+TEST(SpscRingTest, BatchPushIsAllOrNothing) {
+  SpscRing<int> ring(8);
+  const std::vector<int> five{1, 2, 3, 4, 5};
+  ASSERT_TRUE(ring.try_push(std::span<const int>(five)));
+  EXPECT_FALSE(ring.try_push(std::span<const int>(five)));   // only 3 slots left
+
+  std::vector<int> got;
+  EXPECT_EQ(ring.drain([&](int v) { got.push_back(v); }, 2), 2u);
+  EXPECT_EQ(ring.drain([&](int v) { got.push_back(v); }), 3u);
+  EXPECT_EQ(got, five);
+  EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingTest, ConsumerSeesProducerOrderAcrossThreads) {
+  SpscRing<std::uint64_t> ring(256);
+  constexpr std::uint64_t kN = 200000;
+
+  std::thread producer([&] {
+    for (std::uint64_t i = 1; i <= kN;) {
+      if (ring.try_push(i)) ++i;
+      else std::this_thread::yield();
+    }
+  });
+
+  std::uint64_t expect = 1;
+  bool in_order = true;
+  while (expect <= kN) {
+    ring.drain([&](std::uint64_t v) { in_order &= (v == expect); ++expect; });
+  }
+  producer.join();
+  EXPECT_TRUE(in_order);
+  EXPECT_TRUE(ring.empty());
+}
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <vector>
+#define private public
+#include "../aggregator/symbol_pipeline.h"
+#include "../common/delta_book.h"
+#undef private
+
+namespace {
+SymbolSpec spec() {
+  return {"BTCUSDT",
+          {{VenueKind::kBinance, "BTCUSDT", 0.01},
+           {VenueKind::kOkx, "BTC-USDT", 0.1},
+           {VenueKind::kKraken, "BTC-USDT", 0.1}},
+          FixedScale{8, 8}, {0.1, 200}};
+}
+
+// Hand venue v one snapshot message, as its adapter would in delta mode.
+void feed(SymbolPipeline& p, VenueId v, std::initializer_list<double> bids, std::uint64_t seq) {
+  const FixedScale sc{8, 8};
+  std::vector<BookEvent> msg{{BookEvent::Kind::kReset}};
+  for (double b : bids) msg.push_back({BookEvent::Kind::kBid, sc.to_px(b), sc.to_qty(1.0)});
+  msg.push_back({BookEvent::Kind::kCommit, 0, 0, seq});
+  ASSERT_TRUE(p.rings_[v]->try_push(std::span<const BookEvent>(msg)));
+}
+}  // namespace
+
+// Requests with the same depth and tick share one view; zeros take the
+// symbol's defaults. Nothing here starts the adapters.
+TEST(SymbolPipelineTest, SameConsolidationSharesAView) {
+  SymbolPipeline p(spec(), AdapterBase::Conflation{});
+  EXPECT_EQ(p.venues(), 3u);
+
+  EXPECT_EQ(p.subscribe({0.0, 0}).get(), &p.default_view());
+  EXPECT_EQ(p.subscribe({0.1, 200}).get(), &p.default_view());
+
+  auto top = p.subscribe({0.0, 1});
+  ASSERT_NE(top, nullptr);
+  EXPECT_NE(top.get(), &p.default_view());
+  EXPECT_EQ(top->cfg().topN, 1u);
+  EXPECT_EQ(p.subscribe({0.1, 1}), top);
+  EXPECT_EQ(top->subscribers(), 2u);
+
+  auto coarse = p.subscribe({1.0, 1});
+  ASSERT_NE(coarse, nullptr);
+  EXPECT_NE(coarse, top);
+  EXPECT_EQ(coarse->tick(), FixedScale{}.tick_to_px(1.0));
+}
+
+TEST(SymbolPipelineTest, RejectsUnservableConsolidations) {
+  SymbolPipeline p(spec(), AdapterBase::Conflation{});
+  EXPECT_THROW(p.subscribe({-0.1, 10}), std::invalid_argument);
+  EXPECT_THROW(p.subscribe({0.1, SymbolPipeline::kMaxDepth + 1}), std::invalid_argument);
+  EXPECT_THROW(p.subscribe({1e-12, 10}), std::invalid_argument);   // below the price resolution
+
+  for (std::size_t d = 1; d < SymbolPipeline::kMaxViews; ++d) ASSERT_NE(p.subscribe({0.1, d}), nullptr);
+  EXPECT_EQ(p.subscribe({0.1, SymbolPipeline::kMaxViews}), nullptr);
+  EXPECT_NE(p.subscribe({0.1, 1}), nullptr);   // existing views are still found
+}
+
+// The last release frees a view's slot, so cycling through settings never
+// uses the views up; the default view stays.
+TEST(SymbolPipelineTest, ReleasedViewsFreeTheirSlot) {
+  SymbolPipeline p(spec(), AdapterBase::Conflation{});
+  for (std::size_t d = 1; d <= 4 * SymbolPipeline::kMaxViews; ++d) {
+    auto v = p.subscribe({0.1, d});
+    ASSERT_NE(v, nullptr) << d;
+    p.poll();
+    p.release(*v);
+  }
+  p.poll();
+  EXPECT_EQ(p.view_count(), 1u);
+  EXPECT_EQ(p.engine_count(), 1u);
+
+  auto def = p.subscribe({0.0, 0});
+  p.release(*def);
+  EXPECT_EQ(p.view_count(), 1u);
+  EXPECT_EQ(p.subscribe({0.0, 0}).get(), &p.default_view());
+}
+
+// Views at one tick share an engine and each cuts its own depth; a view at
+// another tick gets its own, dropped with the view.
+TEST(SymbolPipelineTest, ViewsAtOneTickShareAnEngine) {
+  SymbolPipeline p(spec(), AdapterBase::Conflation{});
+  auto deep = p.subscribe({0.0, 0});
+  auto top = p.subscribe({0.1, 2});
+  feed(p, 0, {100.0, 99.0, 98.0}, 1);
+  feed(p, 1, {100.0, 97.0}, 1);
+  p.poll();
+  EXPECT_EQ(p.engine_count(), 1u);
+
+  const FixedScale sc{8, 8};
+  ASSERT_EQ(deep->current()->msg.bids_size(), 4);
+  ASSERT_EQ(top->current()->msg.bids_size(), 2);
+  EXPECT_DOUBLE_EQ(top->current()->msg.bids(0).size(), 2.0);
+  EXPECT_EQ(top->book().bids.front().price, sc.to_px(100.0));
+
+  // A change below the shallow view's depth only republishes the deep one.
+  const auto top_v = top->version(), deep_v = deep->version();
+  const std::vector<BookEvent> upd{{BookEvent::Kind::kBid, sc.to_px(97.0), 0},
+                                   {BookEvent::Kind::kBid, sc.to_px(96.0), sc.to_qty(1.0)},
+                                   {BookEvent::Kind::kCommit, 0, 0, 2}};
+  ASSERT_TRUE(p.rings_[1]->try_push(std::span<const BookEvent>(upd)));
+  p.poll();
+  EXPECT_EQ(top->version(), top_v);
+  EXPECT_EQ(deep->version(), deep_v + 1);
+
+  auto coarse = p.subscribe({1.0, 1});
+  p.poll();
+  EXPECT_EQ(p.engine_count(), 2u);
+  ASSERT_EQ(coarse->current()->msg.bids_size(), 1);
+  EXPECT_DOUBLE_EQ(coarse->current()->msg.bids(0).size(), 2.0);   // 100.0 on two venues
+  p.release(*coarse);
+  p.poll();
+  EXPECT_EQ(p.engine_count(), 1u);
+}
+
+// The versions a paced delta stream skipped go out as one frame that takes a
+// client from the first to the last of them.
+TEST(SymbolPipelineTest, MergedDeltasSpanSeveralVersions) {
+  SymbolPipeline p(spec(), AdapterBase::Conflation{});
+  auto view = p.subscribe({0.0, 0});
+  feed(p, 0, {100.0, 99.0, 98.0}, 1);
+  p.poll();
+  const std::uint64_t from = view->version();
+
+  DeltaBook client;
+  bookfeed::BookDelta snap;
+  snap.set_seq(from);
+  snap.set_snapshot(true);
+  snap.mutable_bids()->CopyFrom(view->current()->msg.bids());
+  ASSERT_TRUE(client.apply(snap));
+
+  feed(p, 0, {100.0, 97.0}, 2);          // removes 99 and 98, adds 97
+  p.poll();
+  feed(p, 0, {101.0, 100.0, 97.0}, 3);   // adds 101
+  p.poll();
+  const std::uint64_t to = view->version();
+  ASSERT_EQ(to, from + 2);
+
+  grpc::ByteBuffer bytes;
+  ASSERT_TRUE(view->merge_deltas(from, to, bytes));
+  bookfeed::BookDelta merged;
+  ASSERT_TRUE(grpc::SerializationTraits<bookfeed::BookDelta>::Deserialize(&bytes, &merged).ok());
+  EXPECT_EQ(merged.seq(), to);
+  EXPECT_EQ(merged.base_seq(), from);
+  EXPECT_EQ(merged.bids_size(), 4);       // 101, 99, 98, 97; 100 never changed
+  ASSERT_TRUE(client.apply(merged));
+
+  const auto& got = client.book();
+  const auto& want = view->current()->msg;
+  ASSERT_EQ(got.bids_size(), want.bids_size());
+  for (int i = 0; i < want.bids_size(); ++i) {
+    EXPECT_DOUBLE_EQ(got.bids(i).price(), want.bids(i).price());
+    EXPECT_DOUBLE_EQ(got.bids(i).size(), want.bids(i).size());
+  }
+  EXPECT_FALSE(view->merge_deltas(from, to + 1, bytes));   // not logged yet
+}
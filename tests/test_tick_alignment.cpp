@@ -1,11 +1,15 @@
 #include <gtest/gtest.h>
 #include "../common/consolidator.h"
 
+static const FixedScale sc{};
+
+// Off-scale inputs are rounded away from the touch (bids down, asks up), so a
+// price a hair below a tick boundary stays below it once in fixed point.
 static OrderBook ob_from_pairs(const std::vector<std::pair<double,double>>& bids,
                                const std::vector<std::pair<double,double>>& asks) {
   OrderBook ob;
-  for (auto [p,s] : bids) ob.bids[p] = s;
-  for (auto [p,s] : asks) ob.asks[p] = s;
+  for (auto [p,s] : bids) ob.bids.set(to_fixed_floor(p, sc.px_dp), sc.to_qty(s));
+  for (auto [p,s] : asks) ob.asks.set(to_fixed_ceil(p, sc.px_dp), sc.to_qty(s));
   return ob;
 }
 
@@ -18,13 +22,13 @@ TEST(TickAlignTest, FloorBidsAndCeilAsksWithEpsilons) {
   ASSERT_GE(merged.bids.size(), 2u);
   
   auto itb = merged.bids.begin();
-  EXPECT_DOUBLE_EQ(itb->first, 100.0); EXPECT_DOUBLE_EQ(itb->second, 4.0); ++itb;
-  EXPECT_DOUBLE_EQ(itb->first, 99.5);  EXPECT_DOUBLE_EQ(itb->second, 1.0);
+  EXPECT_EQ(itb->first, sc.to_px(100.0)); EXPECT_EQ(itb->second, sc.to_qty(4.0)); ++itb;
+  EXPECT_EQ(itb->first, sc.to_px(99.5));  EXPECT_EQ(itb->second, sc.to_qty(1.0));
   ASSERT_FALSE(merged.asks.empty());
 
   auto ita = merged.asks.begin();
-  EXPECT_DOUBLE_EQ(ita->first, 101.5);
-  EXPECT_DOUBLE_EQ(ita->second, 7.0);
+  EXPECT_EQ(ita->first, sc.to_px(101.5));
+  EXPECT_EQ(ita->second, sc.to_qty(7.0));
 }
 
 TEST(TickAlignTest, ExactBoundaryStability) {
@@ -35,13 +39,13 @@ TEST(TickAlignTest, ExactBoundaryStability) {
   ASSERT_GE(merged.bids.size(), 2u);
 
   auto itb = merged.bids.begin();
-  EXPECT_DOUBLE_EQ(itb->first, 101.0); EXPECT_DOUBLE_EQ(itb->second, 1.0); ++itb;
-  EXPECT_DOUBLE_EQ(itb->first, 100.5); EXPECT_DOUBLE_EQ(itb->second, 2.0);
+  EXPECT_EQ(itb->first, sc.to_px(101.0)); EXPECT_EQ(itb->second, sc.to_qty(1.0)); ++itb;
+  EXPECT_EQ(itb->first, sc.to_px(100.5)); EXPECT_EQ(itb->second, sc.to_qty(2.0));
   ASSERT_GE(merged.asks.size(), 2u);
 
   auto ita = merged.asks.begin();
-  EXPECT_DOUBLE_EQ(ita->first, 102.0); EXPECT_DOUBLE_EQ(ita->second, 3.0); ++ita;
-  EXPECT_DOUBLE_EQ(ita->first, 102.5); EXPECT_DOUBLE_EQ(ita->second, 4.0);
+  EXPECT_EQ(ita->first, sc.to_px(102.0)); EXPECT_EQ(ita->second, sc.to_qty(3.0)); ++ita;
+  EXPECT_EQ(ita->first, sc.to_px(102.5)); EXPECT_EQ(ita->second, sc.to_qty(4.0));
 }
 
 TEST(TickAlignTest, TopNAppliesAfterAlignment) {
@@ -51,6 +55,6 @@ TEST(TickAlignTest, TopNAppliesAfterAlignment) {
   auto merged = consolidate({a}, cfg);
   ASSERT_EQ(merged.bids.size(), 1u);
   ASSERT_EQ(merged.asks.size(), 1u);
-  EXPECT_DOUBLE_EQ(merged.bids.begin()->first, 100.0);
-  EXPECT_DOUBLE_EQ(merged.asks.begin()->first, 101.5);
+  EXPECT_EQ(merged.bids.begin()->first, sc.to_px(100.0));
+  EXPECT_EQ(merged.asks.begin()->first, sc.to_px(101.5));
 }
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include "../common/version_log.h"
+
+TEST(VersionLogTest, HoldsTheLastCapacityEntries) {
+  VersionLog<int> log(4);
+  EXPECT_EQ(log.at(1), nullptr);
+  for (int v = 1; v <= 6; ++v) log.append(v, std::make_shared<const int>(v * 10));
+
+  EXPECT_EQ(log.newest(), 6u);
+  EXPECT_EQ(log.at(2), nullptr);   // overwritten
+  for (int v = 3; v <= 6; ++v) {
+    auto e = log.at(v);
+    ASSERT_NE(e, nullptr);
+    EXPECT_EQ(*e, v * 10);
+  }
+  EXPECT_EQ(log.at(7), nullptr);   // not yet appended
+}
+
+// A reader keeps its entry even after the log has moved past it.
+TEST(VersionLogTest, FetchedEntriesOutliveTheirSlot) {
+  VersionLog<int> log(2);
+  log.append(1, std::make_shared<const int>(1));
+  auto held = log.at(1);
+  log.append(2, std::make_shared<const int>(2));
+  log.append(3, std::make_shared<const int>(3));
+  EXPECT_EQ(log.at(1), nullptr);
+  ASSERT_NE(held, nullptr);
+  EXPECT_EQ(*held, 1);
+}
+
+// Numbering that jumps drops everything before the jump, so a reader can
+// never stitch entries across it.
+TEST(VersionLogTest, NonConsecutiveAppendStartsOver) {
+  VersionLog<int> log(8);
+  log.append(1, std::make_shared<const int>(1));
+  log.append(2, std::make_shared<const int>(2));
+  log.append(5, std::make_shared<const int>(5));
+  EXPECT_EQ(log.at(2), nullptr);
+  ASSERT_NE(log.at(5), nullptr);
+}
@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include "../common/version_waiters.h"
+
+namespace {
+struct Counter : VersionWaiters::Waiter {
+  int woken{0};
+  void on_version() override { ++woken; }
+};
+}  // namespace
+
+TEST(VersionWaitersTest, ParkedWaitersAreWokenOnceEach) {
+  VersionWaiters lot;
+  Counter a, b;
+  ASSERT_TRUE(lot.park(&a, 0));
+  ASSERT_TRUE(lot.park(&b, 0));
+  lot.wake_all(1);
+  EXPECT_EQ(a.woken, 1);
+  EXPECT_EQ(b.woken, 1);
+
+  // Not parked any more: the next version wakes nobody.
+  lot.wake_all(2);
+  EXPECT_EQ(a.woken, 1);
+  EXPECT_FALSE(lot.unpark(&a));
+}
+
+// A version published between reading it and parking is not missed: park()
+// refuses, and the caller reads again instead of sleeping.
+TEST(VersionWaitersTest, ParkRefusesWhenANewerVersionIsOut) {
+  VersionWaiters lot;
+  Counter a;
+  lot.wake_all(5);
+  EXPECT_FALSE(lot.park(&a, 4));
+  EXPECT_TRUE(lot.park(&a, 5));
+  EXPECT_TRUE(lot.unpark(&a));
+  lot.wake_all(6);
+  EXPECT_EQ(a.woken, 0);
+}
+
+// A waiter may re-park from inside on_version(); that wait is for the next
+// version, not the one being delivered.
+TEST(VersionWaitersTest, WaiterCanReparkFromWake) {
+  struct Repark : VersionWaiters::Waiter {
+    VersionWaiters* lot{nullptr};
+    std::vector<bool> parked;
+    void on_version() override { parked.push_back(lot->park(this, 1)); }
+  };
+  VersionWaiters lot;
+  Repark r;
+  r.lot = &lot;
+  ASSERT_TRUE(lot.park(&r, 0));
+  lot.wake_all(1);
+  ASSERT_EQ(r.parked.size(), 1u);
+  EXPECT_TRUE(r.parked[0]);
+  lot.wake_all(2);
+  EXPECT_EQ(r.parked.size(), 2u);
+}
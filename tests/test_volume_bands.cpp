@@ -84,3 +84,21 @@ TEST(VolumeBandsTest, EdgeCases_Bids) {
   EXPECT_DOUBLE_EQ(vwap_for_notional_bids(book.bids(), 0.0, &qty), 0.0);
   EXPECT_DOUBLE_EQ(qty, 0.0);
 }
+
+TEST(VolumeBandsTest, FixedPointPartialAndFullFill) {
+  const FixedScale sc{};
+  const std::vector<LevelPxSz> asks = {
+    {sc.to_px(100.0), sc.to_qty(1.0)}, {sc.to_px(100.5), sc.to_qty(2.0)}, {sc.to_px(101.0), sc.to_qty(3.0)}};
+
+  qty_t qty = 0;
+  const double vwap = vwap_for_notional(asks, sc, 250.0, &qty);
+  const double exp_qty = 1.0 + (250.0 - 100.0) / 100.5;
+  EXPECT_NEAR(sc.qty_to_double(qty), exp_qty, 1e-8);
+  EXPECT_NEAR(vwap, 250.0 / exp_qty, 1e-6);
+
+  EXPECT_NEAR(vwap_for_notional(asks, sc, 1e9, &qty), (100.0 + 201.0 + 303.0) / 6.0, 1e-9);
+  EXPECT_EQ(qty, sc.to_qty(6.0));
+
+  EXPECT_DOUBLE_EQ(vwap_for_notional(asks, sc, 0.0, &qty), 0.0);
+  EXPECT_EQ(qty, 0);
+}